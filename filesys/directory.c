@@ -1,29 +1,155 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* A directory. */
 struct dir {
 	struct inode *inode;                /* Backing store. */
-	off_t pos;                          /* Current position. */
+	off_t pos;                          /* Next slot for dir_readdir(). */
 };
 
 /* A single directory entry. */
 struct dir_entry {
-	disk_sector_t inode_sector;         /* Sector number of header. */
+	disk_sector_t inode_sector;         /* Sector number of header.
+	                                       Next free slot + 1 if free. */
 	char name[NAME_MAX + 1];            /* Null terminated file name. */
 	bool in_use;                        /* In use or free? */
 };
 
-/* Creates a directory with space for ENTRY_CNT entries in the
- * given SECTOR.  Returns true if successful, false on failure. */
+/* Hashed directory format (P3-EX).
+ * The directory file starts with a header sector, followed by the
+ * entry slots packed ENTRIES_PER_SECTOR to a sector so that an
+ * entry never straddles two sectors.  Entries never move, so
+ * dir_readdir() walks the slots in order, and freed slots are kept
+ * on a free list for reuse.
+ *
+ * Names are found through a hash index that starts at INDEX_OFS,
+ * one bucket per sector holding (name hash, slot) pairs.  The index
+ * lies far past the entries in a sparse region of the file, so
+ * buckets that were never written read as empty.
+ *
+ * Each bucket records its own depth D and holds the names whose
+ * hash has its number in the low D bits.  When a bucket fills up,
+ * only that bucket is split on hash bit D, into itself and bucket
+ * B + 2^D, so an insert rewrites at most a few sectors however big
+ * the directory is.  There is no table of buckets: a name is found
+ * by trying the low bits of its hash from the largest depth down,
+ * and the first bucket that exists is the one holding it. */
+#define DIR_MAGIC 0x44495248            /* Identifies a directory. */
+#define ENTRIES_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (struct dir_entry))
+#define INDEX_OFS (8 * 1024 * 1024)     /* Offset of the hash index. */
+#define MAX_SLOTS ((INDEX_OFS / DISK_SECTOR_SIZE - 1) * ENTRIES_PER_SECTOR)
+#define MAX_DEPTH 16                     /* At most 2^MAX_DEPTH buckets. */
+#define BUCKET_ITEMS 63
+
+/* Directory header, at offset 0. */
+struct dir_header {
+	unsigned magic;                     /* DIR_MAGIC. */
+	uint32_t slot_cnt;                  /* Slots used so far, free or not. */
+	uint32_t free_head;                 /* First free slot + 1, 0 if none. */
+	uint32_t depth;                     /* Largest bucket depth. */
+};
+
+/* A hash index bucket, one sector. */
+struct dir_bucket {
+	uint32_t cnt;                       /* Number of items. */
+	struct {
+		uint32_t hash;                  /* Hash of the entry's name. */
+		uint32_t slot;                  /* Slot of the entry. */
+	} items[BUCKET_ITEMS];
+	uint32_t depth;                     /* Depth + 1, 0 if never written. */
+};
+
+static bool read_header (const struct dir *, struct dir_header *);
+static bool write_header (struct dir *, const struct dir_header *);
+static bool read_slot (const struct dir *, uint32_t slot, struct dir_entry *);
+static bool write_slot (struct dir *, uint32_t slot, const struct dir_entry *);
+static bool read_bucket (const struct dir *, uint32_t b, struct dir_bucket *);
+static bool write_bucket (struct dir *, uint32_t b, const struct dir_bucket *);
+static bool find_bucket (const struct dir *, const struct dir_header *,
+		uint32_t hash, uint32_t *bp, struct dir_bucket *);
+static bool split_bucket (struct dir *, struct dir_header *, uint32_t b,
+		struct dir_bucket *);
+static uint32_t name_hash (const char *name);
+
+/* Directory entry cache (P3-EX).
+ * Caches the result of looking up NAME in the directory whose inode
+ * is at PARENT, including names that were not found (negative
+ * entries), so that opening a hot path does not read the directory.
+ * dir_add() and dir_remove() update the entry for the name they
+ * change.  At most DCACHE_MAX entries are kept, least recently used
+ * first out. */
+#define DCACHE_MAX 512
+
+struct dentry {
+	struct hash_elem elem;              /* dcache. */
+	struct list_elem lru_elem;          /* dcache_lru. */
+	disk_sector_t parent;               /* Inode sector of the directory. */
+	char name[NAME_MAX + 1];            /* Null terminated file name. */
+	bool negative;                      /* NAME does not exist. */
+	disk_sector_t inode_sector;         /* Inode of NAME if !negative. */
+};
+
+enum dcache_result {
+	DCACHE_MISS,                        /* Not cached. */
+	DCACHE_HIT,                         /* NAME exists. */
+	DCACHE_NEGATIVE                     /* NAME is known not to exist. */
+};
+
+static struct hash dcache;
+static struct list dcache_lru;          /* Most recently used first. */
+static struct lock dcache_lock;         /* Protects the above and below. */
+static unsigned dcache_gen;             /* Bumped on every directory change. */
+static struct inode *root_inode;        /* Root directory, kept open. */
+
+static enum dcache_result dcache_lookup (disk_sector_t parent,
+		const char *name, disk_sector_t *sectorp, unsigned *genp);
+static void dcache_insert (disk_sector_t parent, const char *name,
+		bool negative, disk_sector_t sector, unsigned gen);
+static void dcache_update (disk_sector_t parent, const char *name,
+		bool negative, disk_sector_t sector);
+static uint64_t dentry_hash (const struct hash_elem *, void *);
+static bool dentry_less (const struct hash_elem *, const struct hash_elem *,
+		void *);
+
+/* Initializes the directory module. */
+void
+dir_init (void) {
+	hash_init (&dcache, dentry_hash, dentry_less, NULL);
+	list_init (&dcache_lru);
+	lock_init (&dcache_lock);
+}
+
+/* Creates a directory in the given SECTOR.  ENTRY_CNT is only a
+ * hint, since entry slots and index buckets are allocated as they
+ * are first used.  Returns true if successful, false on failure. */
 bool
-dir_create (disk_sector_t sector, size_t entry_cnt) {
-	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+dir_create (disk_sector_t sector, size_t entry_cnt UNUSED) {
+	struct dir_header h = {
+		.magic = DIR_MAGIC,
+		.slot_cnt = 0,
+		.free_head = 0,
+		.depth = 0,
+	};
+	struct dir *dir;
+	bool success;
+
+	ASSERT (sizeof (struct dir_bucket) == DISK_SECTOR_SIZE);
+
+	if (!inode_create (sector, 0))
+		return false;
+	dir = dir_open (inode_open (sector));
+	if (dir == NULL)
+		return false;
+	success = write_header (dir, &h);
+	dir_close (dir);
+	return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -32,6 +158,7 @@ struct dir *
 dir_open (struct inode *inode) {
 	struct dir *dir = calloc (1, sizeof *dir);
 	if (inode != NULL && dir != NULL) {
+		inode_set_metadata (inode);
 		dir->inode = inode;
 		dir->pos = 0;
 		return dir;
@@ -46,7 +173,15 @@ dir_open (struct inode *inode) {
  * Return true if successful, false on failure. */
 struct dir *
 dir_open_root (void) {
-	return dir_open (inode_open (ROOT_DIR_SECTOR));
+	struct inode *inode;
+
+	// 경로마다 root inode를 디스크에서 다시 읽지 않도록 열어둔 채로 유지
+	lock_acquire (&dcache_lock);
+	if (root_inode == NULL)
+		root_inode = inode_open (ROOT_DIR_SECTOR);
+	inode = inode_reopen (root_inode);
+	lock_release (&dcache_lock);
+	return dir_open (inode);
 }
 
 /* Opens and returns a new directory for the same inode as DIR.
@@ -73,28 +208,40 @@ dir_get_inode (struct dir *dir) {
 
 /* Searches DIR for a file with the given NAME.
  * If successful, returns true, sets *EP to the directory entry
- * if EP is non-null, and sets *OFSP to the byte offset of the
- * directory entry if OFSP is non-null.
- * otherwise, returns false and ignores EP and OFSP. */
+ * if EP is non-null, and sets *SLOTP to the entry's slot if SLOTP
+ * is non-null.
+ * otherwise, returns false and ignores EP and SLOTP. */
 static bool
 lookup (const struct dir *dir, const char *name,
-		struct dir_entry *ep, off_t *ofsp) {
+		struct dir_entry *ep, uint32_t *slotp) {
+	struct dir_header h;
+	struct dir_bucket *bucket;
 	struct dir_entry e;
-	size_t ofs;
+	uint32_t hash = name_hash (name);
+	bool found = false;
+	uint32_t b;
+	size_t i;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (e.in_use && !strcmp (name, e.name)) {
-			if (ep != NULL)
-				*ep = e;
-			if (ofsp != NULL)
-				*ofsp = ofs;
-			return true;
-		}
-	return false;
+	bucket = malloc (sizeof *bucket);
+	if (bucket == NULL)
+		return false;
+	if (read_header (dir, &h) && find_bucket (dir, &h, hash, &b, bucket)) {
+		for (i = 0; i < bucket->cnt && !found; i++)
+			if (bucket->items[i].hash == hash
+					&& read_slot (dir, bucket->items[i].slot, &e)
+					&& e.in_use && !strcmp (name, e.name)) {
+				if (ep != NULL)
+					*ep = e;
+				if (slotp != NULL)
+					*slotp = bucket->items[i].slot;
+				found = true;
+			}
+	}
+	free (bucket);
+	return found;
 }
 
 /* Searches DIR for a file with the given NAME
@@ -104,15 +251,31 @@ lookup (const struct dir *dir, const char *name,
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
+	disk_sector_t parent = inode_get_inumber (dir->inode);
+	disk_sector_t sector;
 	struct dir_entry e;
+	unsigned gen;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
-	else
-		*inode = NULL;
+	switch (dcache_lookup (parent, name, &sector, &gen)) {
+		case DCACHE_HIT:
+			*inode = inode_open (sector);
+			break;
+		case DCACHE_NEGATIVE:
+			*inode = NULL;
+			break;
+		default:
+			if (lookup (dir, name, &e, NULL)) {
+				dcache_insert (parent, name, false, e.inode_sector, gen);
+				*inode = inode_open (e.inode_sector);
+			} else {
+				dcache_insert (parent, name, true, 0, gen);
+				*inode = NULL;
+			}
+			break;
+	}
 
 	return *inode != NULL;
 }
@@ -125,8 +288,11 @@ dir_lookup (const struct dir *dir, const char *name,
  * error occurs. */
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
+	struct dir_header h;
+	struct dir_bucket *bucket = NULL;
 	struct dir_entry e;
-	off_t ofs;
+	uint32_t hash = name_hash (name);
+	uint32_t slot, b;
 	bool success = false;
 
 	ASSERT (dir != NULL);
@@ -140,25 +306,46 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
 
-	/* Set OFS to offset of free slot.
-	 * If there are no free slots, then it will be set to the
-	 * current end-of-file.
+	bucket = malloc (sizeof *bucket);
+	if (bucket == NULL || !read_header (dir, &h))
+		goto done;
 
-	 * inode_read_at() will only return a short read at end of file.
-	 * Otherwise, we'd need to verify that we didn't get a short
-	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (!e.in_use)
+	/* Find the bucket for NAME, splitting it until it has room. */
+	for (;;) {
+		if (!find_bucket (dir, &h, hash, &b, bucket))
+			goto done;
+		if (bucket->cnt < BUCKET_ITEMS)
 			break;
+		if (!split_bucket (dir, &h, b, bucket))
+			goto done;
+	}
+
+	/* Take a free slot, or a new one at the end of the entries. */
+	if (h.free_head != 0) {
+		slot = h.free_head - 1;
+		if (!read_slot (dir, slot, &e))
+			goto done;
+		h.free_head = e.inode_sector;
+	} else if (h.slot_cnt < MAX_SLOTS)
+		slot = h.slot_cnt++;
+	else
+		goto done;
 
-	/* Write slot. */
+	/* Write slot, then index it. */
 	e.in_use = true;
 	strlcpy (e.name, name, sizeof e.name);
 	e.inode_sector = inode_sector;
-	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+	bucket->items[bucket->cnt].hash = hash;
+	bucket->items[bucket->cnt].slot = slot;
+	bucket->cnt++;
+	success = write_slot (dir, slot, &e)
+		&& write_bucket (dir, b, bucket)
+		&& write_header (dir, &h);
+	if (success)
+		dcache_update (inode_get_inumber (dir->inode), name, false, inode_sector);
 
 done:
+	free (bucket);
 	return success;
 }
 
@@ -167,16 +354,19 @@ done:
  * which occurs only if there is no file with the given NAME. */
 bool
 dir_remove (struct dir *dir, const char *name) {
+	struct dir_header h;
+	struct dir_bucket *bucket = NULL;
 	struct dir_entry e;
 	struct inode *inode = NULL;
+	uint32_t slot, b;
 	bool success = false;
-	off_t ofs;
+	size_t i;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
 	/* Find directory entry. */
-	if (!lookup (dir, name, &e, &ofs))
+	if (!lookup (dir, name, &e, &slot))
 		goto done;
 
 	/* Open inode. */
@@ -184,16 +374,34 @@ dir_remove (struct dir *dir, const char *name) {
 	if (inode == NULL)
 		goto done;
 
-	/* Erase directory entry. */
+	/* Drop the entry from its bucket. */
+	bucket = malloc (sizeof *bucket);
+	if (bucket == NULL || !read_header (dir, &h))
+		goto done;
+	if (!find_bucket (dir, &h, name_hash (name), &b, bucket))
+		goto done;
+	for (i = 0; i < bucket->cnt; i++)
+		if (bucket->items[i].slot == slot) {
+			bucket->items[i] = bucket->items[--bucket->cnt];
+			break;
+		}
+	if (!write_bucket (dir, b, bucket))
+		goto done;
+
+	/* Erase directory entry and put its slot on the free list. */
 	e.in_use = false;
-	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+	e.inode_sector = h.free_head;
+	h.free_head = slot + 1;
+	if (!write_slot (dir, slot, &e) || !write_header (dir, &h))
 		goto done;
 
 	/* Remove inode. */
+	dcache_update (inode_get_inumber (dir->inode), name, true, 0);
 	inode_remove (inode);
 	success = true;
 
 done:
+	free (bucket);
 	inode_close (inode);
 	return success;
 }
@@ -203,10 +411,14 @@ done:
  * contains no more entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
+	struct dir_header h;
 	struct dir_entry e;
 
-	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
-		dir->pos += sizeof e;
+	if (!read_header (dir, &h))
+		return false;
+	while ((uint32_t) dir->pos < h.slot_cnt
+			&& read_slot (dir, dir->pos, &e)) {
+		dir->pos++;
 		if (e.in_use) {
 			strlcpy (name, e.name, NAME_MAX + 1);
 			return true;
@@ -214,3 +426,229 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	}
 	return false;
 }
+
+// ===== [Hashed directory] =====
+
+static bool
+read_header (const struct dir *dir, struct dir_header *h) {
+	if (inode_read_at (dir->inode, h, sizeof *h, 0) != sizeof *h)
+		return false;
+	if (h->magic != DIR_MAGIC) {
+		printf ("[DBG] read_header(): inode %"PRDSNu" is not a directory\n",
+				inode_get_inumber (dir->inode));
+		return false;
+	}
+	return true;
+}
+
+static bool
+write_header (struct dir *dir, const struct dir_header *h) {
+	return inode_write_at (dir->inode, h, sizeof *h, 0) == sizeof *h;
+}
+
+// SLOT번째 entry의 파일 내 위치, 헤더 sector 다음부터 sector마다 ENTRIES_PER_SECTOR개
+static off_t
+slot_ofs (uint32_t slot) {
+	return DISK_SECTOR_SIZE * (1 + slot / ENTRIES_PER_SECTOR)
+		+ slot % ENTRIES_PER_SECTOR * sizeof (struct dir_entry);
+}
+
+static bool
+read_slot (const struct dir *dir, uint32_t slot, struct dir_entry *e) {
+	return inode_read_at (dir->inode, e, sizeof *e, slot_ofs (slot)) == sizeof *e;
+}
+
+static bool
+write_slot (struct dir *dir, uint32_t slot, const struct dir_entry *e) {
+	return inode_write_at (dir->inode, e, sizeof *e, slot_ofs (slot)) == sizeof *e;
+}
+
+// 아직 쓰지 않은 bucket은 hole이거나 파일 끝 너머이므로 빈 bucket으로 읽음
+static bool
+read_bucket (const struct dir *dir, uint32_t b, struct dir_bucket *bucket) {
+	off_t ofs = INDEX_OFS + (off_t) b * DISK_SECTOR_SIZE;
+	off_t n = inode_read_at (dir->inode, bucket, sizeof *bucket, ofs);
+
+	if (n < 0)
+		return false;
+	memset ((uint8_t *) bucket + n, 0, sizeof *bucket - n);
+	return bucket->cnt <= BUCKET_ITEMS;
+}
+
+static bool
+write_bucket (struct dir *dir, uint32_t b, const struct dir_bucket *bucket) {
+	off_t ofs = INDEX_OFS + (off_t) b * DISK_SECTOR_SIZE;
+	return inode_write_at (dir->inode, bucket, sizeof *bucket, ofs)
+		== sizeof *bucket;
+}
+
+// HASH가 속한 bucket을 찾아 BUCKET에 읽고 번호를 *BP에 저장함
+// 가장 큰 depth부터 hash의 하위 bit를 줄여가며, 처음으로 존재하는 bucket이 답
+// bucket 0은 기록된 적이 없어도 항상 존재함
+static bool
+find_bucket (const struct dir *dir, const struct dir_header *h,
+		uint32_t hash, uint32_t *bp, struct dir_bucket *bucket) {
+	uint32_t depth = h->depth < MAX_DEPTH ? h->depth : MAX_DEPTH;
+
+	for (;;) {
+		uint32_t b = hash & ((1u << depth) - 1);
+
+		if (!read_bucket (dir, b, bucket))
+			return false;
+		if (bucket->depth != 0 || depth == 0) {
+			*bp = b;
+			return true;
+		}
+		depth--;
+	}
+}
+
+// 가득 찬 bucket B(내용은 BUCKET)만 둘로 나눔
+// depth가 D라면 hash의 D번 bit가 1인 item을 B + 2^D로 옮기고 두 bucket의 depth를 D + 1로 함
+// 필요하면 헤더의 depth도 갱신해서 기록함
+static bool
+split_bucket (struct dir *dir, struct dir_header *h, uint32_t b,
+		struct dir_bucket *bucket) {
+	uint32_t depth = bucket->depth != 0 ? bucket->depth - 1 : 0;
+	struct dir_bucket *hi;
+	size_t i, n = 0;
+	bool success;
+
+	if (depth >= MAX_DEPTH)
+		return false;
+	hi = calloc (1, sizeof *hi);
+	if (hi == NULL)
+		return false;
+
+	for (i = 0; i < bucket->cnt; i++) {
+		if (bucket->items[i].hash & (1u << depth))
+			hi->items[hi->cnt++] = bucket->items[i];
+		else
+			bucket->items[n++] = bucket->items[i];
+	}
+	bucket->cnt = n;
+	bucket->depth = hi->depth = depth + 2;
+	// 옮겨간 item이 두 bucket에 모두 남지 않도록 새 bucket을 먼저 기록
+	success = write_bucket (dir, b + (1u << depth), hi)
+		&& write_bucket (dir, b, bucket);
+	free (hi);
+
+	if (success && h->depth < depth + 1) {
+		h->depth = depth + 1;
+		success = write_header (dir, h);
+	}
+	return success;
+}
+
+static uint32_t
+name_hash (const char *name) {
+	return hash_string (name);
+}
+
+// ===== [Dentry cache] =====
+
+// PARENT 디렉토리의 NAME을 cache에서 찾음
+// 없다면 *GENP에 현재 세대를 저장해 나중에 dcache_insert()에 넘겨야 함
+static enum dcache_result
+dcache_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp, unsigned *genp) {
+	enum dcache_result result = DCACHE_MISS;
+	struct dentry key;
+	struct hash_elem *e;
+
+	key.parent = parent;
+	strlcpy (key.name, name, sizeof key.name);
+
+	lock_acquire (&dcache_lock);
+	e = hash_find (&dcache, &key.elem);
+	if (strlen (name) > NAME_MAX) {
+		// 잘린 이름으로 다른 파일을 찾지 않도록 함, 이런 이름의 파일은 없음
+		result = DCACHE_NEGATIVE;
+	} else if (e != NULL) {
+		struct dentry *d = hash_entry (e, struct dentry, elem);
+
+		list_remove (&d->lru_elem);
+		list_push_front (&dcache_lru, &d->lru_elem);
+		if (d->negative)
+			result = DCACHE_NEGATIVE;
+		else {
+			*sectorp = d->inode_sector;
+			result = DCACHE_HIT;
+		}
+	}
+	*genp = dcache_gen;
+	lock_release (&dcache_lock);
+	return result;
+}
+
+// 디스크에서 찾은 결과를 cache에 추가함
+// 그 사이에 디렉토리가 바뀌었다면 (세대가 GEN이 아님) 결과가 오래됐을 수 있으므로 버림
+static void
+dcache_insert (disk_sector_t parent, const char *name, bool negative,
+		disk_sector_t sector, unsigned gen) {
+	struct dentry *d;
+
+	if (strlen (name) > NAME_MAX)
+		return;
+	d = malloc (sizeof *d);
+	if (d == NULL)
+		return;
+	d->parent = parent;
+	strlcpy (d->name, name, sizeof d->name);
+	d->negative = negative;
+	d->inode_sector = sector;
+
+	lock_acquire (&dcache_lock);
+	if (gen != dcache_gen || hash_insert (&dcache, &d->elem) != NULL) {
+		lock_release (&dcache_lock);
+		free (d);
+		return;
+	}
+	list_push_front (&dcache_lru, &d->lru_elem);
+	if (hash_size (&dcache) > DCACHE_MAX) {
+		struct dentry *victim = list_entry (list_pop_back (&dcache_lru),
+				struct dentry, lru_elem);
+		hash_delete (&dcache, &victim->elem);
+		free (victim);
+	}
+	lock_release (&dcache_lock);
+}
+
+// 디렉토리를 바꾼 뒤 NAME의 entry를 새 상태로 고침 (없다면 그대로 둠)
+// 진행중인 다른 조회가 바뀌기 전의 결과를 넣지 못하도록 세대를 올림
+static void
+dcache_update (disk_sector_t parent, const char *name, bool negative,
+		disk_sector_t sector) {
+	struct dentry key;
+	struct hash_elem *e;
+
+	key.parent = parent;
+	strlcpy (key.name, name, sizeof key.name);
+
+	lock_acquire (&dcache_lock);
+	dcache_gen++;
+	e = hash_find (&dcache, &key.elem);
+	if (e != NULL) {
+		struct dentry *d = hash_entry (e, struct dentry, elem);
+		d->negative = negative;
+		d->inode_sector = sector;
+	}
+	lock_release (&dcache_lock);
+}
+
+static uint64_t
+dentry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dentry *d = hash_entry (e, struct dentry, elem);
+	return hash_string (d->name) ^ hash_int (d->parent);
+}
+
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dentry *a = hash_entry (a_, struct dentry, elem);
+	const struct dentry *b = hash_entry (b_, struct dentry, elem);
+
+	if (a->parent != b->parent)
+		return a->parent < b->parent;
+	return strcmp (a->name, b->name) < 0;
+}
@@ -1,8 +1,11 @@
 #include "filesys/fat.h"
+#include <bitmap.h>
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -24,6 +27,14 @@ struct fat_fs {
 	disk_sector_t data_start;
 	cluster_t last_clst;
 	struct lock write_lock;
+
+	// P3-EX: free cluster summary
+	uint64_t *free_bits;   // cluster마다 1 bit, 1이면 free
+	cluster_t free_cnt;    // free cluster 수
+
+	// P3-EX: journal
+	struct bitmap *dirty;  // journal로 기록하지 않은 FAT sector
+	uint64_t *released[2]; // commit 전까지 할당하지 않는 cluster, transaction id의 parity별
 };
 
 static struct fat_fs *fat_fs;
@@ -31,6 +42,14 @@ static struct fat_fs *fat_fs;
 void fat_boot_create (void);
 void fat_fs_init (void);
 
+static void fat_index_init (void);
+static void fat_set (cluster_t clst, cluster_t val);
+static void write_fat_sector (size_t i);
+static cluster_t next_free (cluster_t clst, cluster_t end);
+static cluster_t next_used (cluster_t clst, cluster_t end);
+static cluster_t find_run (cluster_t start, size_t cnt, cluster_t end);
+static cluster_t alloc_run (cluster_t hint, size_t cnt);
+
 void
 fat_init (void) {
 	fat_fs = calloc (1, sizeof (struct fat_fs));
@@ -53,6 +72,8 @@ fat_init (void) {
 
 void
 fat_open (void) {
+	// format 직후에 다시 여는 경우 fat_create()가 만든 table을 버림
+	free (fat_fs->fat);
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT load failed");
@@ -78,6 +99,8 @@ fat_open (void) {
 			free (bounce);
 		}
 	}
+
+	fat_index_init ();
 }
 
 void
@@ -90,27 +113,11 @@ fat_close (void) {
 	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
 	free (bounce);
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
-	}
+	// journal을 쓰는 중이라면 바뀐 sector만 journal을 통해 기록하고
+	// (journal_close()가 commit), 아니라면 FAT 전체를 디스크에 바로 기록
+	if (!journal_enabled ())
+		bitmap_set_all (fat_fs->dirty, true);
+	fat_flush ();
 }
 
 void
@@ -123,10 +130,17 @@ fat_create (void) {
 	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
 	if (fat_fs->fat == NULL)
 		PANIC ("FAT creation failed");
+	fat_index_init ();
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
 
+	// 그 다음 cluster들은 journal이 사용함 (filesys/journal.c)
+	for (cluster_t clst = JOURNAL_CLUSTER;
+	     clst + 1 < JOURNAL_CLUSTER + JOURNAL_SECTORS; clst++)
+		fat_put (clst, clst + 1);
+	fat_put (JOURNAL_CLUSTER + JOURNAL_SECTORS - 1, EOChain);
+
 	// Fill up ROOT_DIR_CLUSTER region with 0
 	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
 	if (buf == NULL)
@@ -152,7 +166,31 @@ fat_boot_create (void) {
 
 void
 fat_fs_init (void) {
-	/* TODO: Your code goes here. */
+	const unsigned int entries_per_sector = DISK_SECTOR_SIZE / sizeof (cluster_t);
+
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+
+	// cluster 0은 "chain 없음"을 뜻하므로 사용하지 않음, data 영역은 cluster 1부터
+	fat_fs->fat_length = (fat_fs->bs.total_sectors - fat_fs->data_start)
+	                     / SECTORS_PER_CLUSTER + 1;
+	if (fat_fs->fat_length > fat_fs->bs.fat_sectors * entries_per_sector)
+		fat_fs->fat_length = fat_fs->bs.fat_sectors * entries_per_sector;
+
+	fat_fs->last_clst = ROOT_DIR_CLUSTER;
+	lock_init (&fat_fs->write_lock);
+
+	// format하는 경우 fat_init()에서 이미 한 번 불렸으므로 다시 만듦
+	size_t words = DIV_ROUND_UP (fat_fs->fat_length, 64);
+	if (fat_fs->dirty != NULL)
+		bitmap_destroy (fat_fs->dirty);
+	free (fat_fs->released[0]);
+	free (fat_fs->released[1]);
+	fat_fs->dirty = bitmap_create (fat_fs->bs.fat_sectors);
+	fat_fs->released[0] = calloc (words, sizeof (uint64_t));
+	fat_fs->released[1] = calloc (words, sizeof (uint64_t));
+	if (fat_fs->dirty == NULL || fat_fs->released[0] == NULL
+	    || fat_fs->released[1] == NULL)
+		PANIC ("FAT init failed");
 }
 
 /*----------------------------------------------------------------------------*/
@@ -164,30 +202,297 @@ fat_fs_init (void) {
  * Returns 0 if fails to allocate a new cluster. */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	return fat_create_chain_multiple (clst, 1);
+}
+
+/* Add CNT clusters that are consecutive on disk to the chain.
+ * If CLST is 0, start a new chain.
+ * Returns the first new cluster, or 0 if there is no free run of
+ * CNT clusters. */
+cluster_t
+fat_create_chain_multiple (cluster_t clst, size_t cnt) {
+	cluster_t first;
+	size_t i;
+
+	ASSERT (cnt > 0);
+	ASSERT (clst == 0 || fat_get (clst) == EOChain);
+
+	lock_acquire (&fat_fs->write_lock);
+	// chain을 늘리는 경우 바로 뒤의 cluster부터 찾아 파일이 연속으로 놓이게 함
+	first = alloc_run (clst != 0 ? clst + 1 : fat_fs->last_clst + 1, cnt);
+	if (first != 0) {
+		for (i = 0; i + 1 < cnt; i++)
+			fat_set (first + i, first + i + 1);
+		fat_set (first + cnt - 1, EOChain);
+		if (clst != 0)
+			fat_set (clst, first);
+		fat_fs->last_clst = first + cnt - 1;
+	}
+	lock_release (&fat_fs->write_lock);
+	return first;
+}
+
+/* Append up to CNT clusters to the chain ending at CLST, taking only
+ * the free clusters that directly follow CLST on disk.
+ * Returns the number of clusters appended. */
+size_t
+fat_extend_chain (cluster_t clst, size_t cnt) {
+	cluster_t end;
+	size_t got, i;
+
+	lock_acquire (&fat_fs->write_lock);
+	ASSERT (clst != 0 && fat_fs->fat[clst] == EOChain);
+	end = clst + 1 + cnt < fat_fs->fat_length ? clst + 1 + cnt : fat_fs->fat_length;
+	got = next_used (clst + 1, end) - (clst + 1);
+	for (i = 0; i < got; i++)
+		fat_set (clst + i, clst + i + 1);
+	if (got > 0) {
+		fat_set (clst + got, EOChain);
+		fat_fs->last_clst = clst + got;
+	}
+	lock_release (&fat_fs->write_lock);
+	return got;
 }
 
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+	if (pclst != 0) {
+		ASSERT (fat_fs->fat[pclst] == clst);
+		fat_set (pclst, EOChain);
+	}
+	while (clst != EOChain) {
+		cluster_t next;
+
+		ASSERT (clst != 0 && clst < fat_fs->fat_length);
+		next = fat_fs->fat[clst];
+		fat_set (clst, 0);
+		clst = next;
+	}
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
 void
 fat_put (cluster_t clst, cluster_t val) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+	fat_set (clst, val);
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Fetch a value in the FAT table. */
 cluster_t
 fat_get (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+	return fat_fs->fat[clst];
 }
 
 /* Covert a cluster # to a sector number. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+	return fat_fs->data_start + (clst - 1) * SECTORS_PER_CLUSTER;
+}
+
+/* Covert a sector number in the data area to its cluster #. */
+cluster_t
+sector_to_cluster (disk_sector_t sector) {
+	ASSERT (sector >= fat_fs->data_start);
+	return (sector - fat_fs->data_start) / SECTORS_PER_CLUSTER + 1;
+}
+
+// ===== [Journal] =====
+// FAT은 메모리에서 바꾸고 바뀐 sector를 표시해 두었다가, 연산이 끝날 때
+// (journal_end() -> free_map_flush()) 그 연산의 transaction에 넣음
+
+/* Writes the FAT sectors changed since the last call through the
+ * journal. */
+void
+fat_flush (void) {
+	size_t i = 0;
+
+	// 다른 쓰레드가 더 최근 내용을 먼저 기록하지 않도록 lock을 잡은 채로 기록
+	lock_acquire (&fat_fs->write_lock);
+	while ((i = bitmap_scan_and_flip (fat_fs->dirty, i, 1, true)) != BITMAP_ERROR)
+		write_fat_sector (i++);
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Called when journal transaction ID has been committed: the
+ * clusters it released may now be allocated again. */
+void
+fat_committed (uint32_t id) {
+	uint64_t *released = fat_fs->released[id % 2];
+	size_t words = DIV_ROUND_UP (fat_fs->fat_length, 64);
+
+	lock_acquire (&fat_fs->write_lock);
+	for (size_t i = 0; i < words; i++) {
+		uint64_t bits = released[i];
+
+		fat_fs->free_bits[i] |= bits;
+		released[i] = 0;
+		for (; bits != 0; bits &= bits - 1)
+			fat_fs->free_cnt++;
+	}
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Returns true if some clusters are released but cannot be
+ * allocated until their transaction is committed. */
+bool
+fat_pending (void) {
+	size_t words = DIV_ROUND_UP (fat_fs->fat_length, 64);
+	bool pending = false;
+
+	lock_acquire (&fat_fs->write_lock);
+	for (size_t i = 0; i < words && !pending; i++)
+		pending = (fat_fs->released[0][i] | fat_fs->released[1][i]) != 0;
+	lock_release (&fat_fs->write_lock);
+	return pending;
+}
+
+// FAT의 I번째 sector를 journal_write()로 기록, write_lock을 잡은 상태로 호출
+// 마지막 sector에서 fat 배열 밖의 부분은 0으로 채움
+static void
+write_fat_sector (size_t i) {
+	static uint8_t bounce[DISK_SECTOR_SIZE]; // write_lock으로 보호됨
+	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
+	const off_t ofs = (off_t) i * DISK_SECTOR_SIZE;
+	const uint8_t *buffer = (const uint8_t *) fat_fs->fat + ofs;
+
+	if (fat_size_in_bytes - ofs < DISK_SECTOR_SIZE) {
+		memset (bounce, 0, DISK_SECTOR_SIZE);
+		if (fat_size_in_bytes > ofs)
+			memcpy (bounce, buffer, fat_size_in_bytes - ofs);
+		buffer = bounce;
+	}
+	journal_write (fat_fs->bs.fat_start + i, buffer);
+}
+
+// ===== [Free cluster summary] =====
+// 매번 fat 배열을 훑지 않도록 free cluster를 bit로 모아두고,
+// 마지막으로 할당한 위치(last_clst) 다음부터 찾는 next-fit으로 할당함
+
+// 읽어들인 fat으로 free_bits를 만듦
+static void
+fat_index_init (void) {
+	size_t words = DIV_ROUND_UP (fat_fs->fat_length, 64);
+	cluster_t clst;
+
+	free (fat_fs->free_bits);
+	fat_fs->free_bits = calloc (words, sizeof *fat_fs->free_bits);
+	if (fat_fs->free_bits == NULL)
+		PANIC ("FAT index creation failed");
+
+	fat_fs->free_cnt = 0;
+	for (clst = 1; clst < fat_fs->fat_length; clst++)
+		if (fat_fs->fat[clst] == 0) {
+			fat_fs->free_bits[clst / 64] |= 1ULL << (clst % 64);
+			fat_fs->free_cnt++;
+		}
+}
+
+// fat entry를 바꾸고 free_bits에 반영, write_lock을 잡은 상태로 호출
+// journal을 쓰는 중에 반납된 cluster는 그 transaction이 commit될 때 free가 됨
+// (crash 후에도 이전 metadata가 가리킬 수 있으므로 그 전에는 새 데이터를 쓰지 않음)
+static void
+fat_set (cluster_t clst, cluster_t val) {
+	uint64_t bit = 1ULL << (clst % 64);
+	bool was_free;
+
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+	was_free = fat_fs->fat[clst] == 0;
+	fat_fs->fat[clst] = val;
+	bitmap_mark (fat_fs->dirty, clst / (DISK_SECTOR_SIZE / sizeof (cluster_t)));
+	if (was_free && val != 0) {
+		ASSERT (fat_fs->free_bits[clst / 64] & bit);
+		fat_fs->free_bits[clst / 64] &= ~bit;
+		fat_fs->free_cnt--;
+	} else if (!was_free && val == 0) {
+		if (journal_enabled ())
+			fat_fs->released[journal_current () % 2][clst / 64] |= bit;
+		else {
+			fat_fs->free_bits[clst / 64] |= bit;
+			fat_fs->free_cnt++;
+		}
+	}
+}
+
+// [CLST, END)에서 처음 나오는 free cluster, 없다면 END
+static cluster_t
+next_free (cluster_t clst, cluster_t end) {
+	while (clst < end) {
+		uint64_t bits = fat_fs->free_bits[clst / 64] >> (clst % 64);
+
+		if (bits == 0) {
+			// 이 word에는 free cluster가 없음
+			clst = ROUND_DOWN (clst, 64) + 64;
+			continue;
+		}
+		while ((bits & 1) == 0) {
+			bits >>= 1;
+			clst++;
+		}
+		return clst < end ? clst : end;
+	}
+	return end;
+}
+
+// [CLST, END)에서 처음 나오는 사용중인 cluster, 없다면 END
+static cluster_t
+next_used (cluster_t clst, cluster_t end) {
+	while (clst < end) {
+		uint64_t bits = ~fat_fs->free_bits[clst / 64] >> (clst % 64);
+
+		if (bits == 0) {
+			clst = ROUND_DOWN (clst, 64) + 64;
+			continue;
+		}
+		while ((bits & 1) == 0) {
+			bits >>= 1;
+			clst++;
+		}
+		return clst < end ? clst : end;
+	}
+	return end;
+}
+
+// [START, END)에서 CNT개의 연속된 free cluster를 찾음, 없다면 0
+static cluster_t
+find_run (cluster_t start, size_t cnt, cluster_t end) {
+	cluster_t clst = start;
+
+	while (clst < end) {
+		cluster_t run_end;
+
+		clst = next_free (clst, end);
+		if (end - clst < cnt)
+			return 0;
+		run_end = next_used (clst, clst + cnt);
+		if (run_end == clst + cnt)
+			return clst;
+		clst = run_end;
+	}
+	return 0;
+}
+
+// HINT부터 끝까지, 그 다음 처음부터 HINT까지 CNT개의 연속된 free cluster를 찾음
+// write_lock을 잡은 상태로 호출
+static cluster_t
+alloc_run (cluster_t hint, size_t cnt) {
+	cluster_t clst;
+
+	if (fat_fs->free_cnt < cnt)
+		return 0;
+	if (hint == 0 || hint >= fat_fs->fat_length)
+		hint = 1;
+
+	clst = find_run (hint, cnt, fat_fs->fat_length);
+	if (clst == 0 && hint > 1) {
+		cluster_t end = hint + cnt - 1;
+		clst = find_run (1, cnt, end < fat_fs->fat_length ? end : fat_fs->fat_length);
+	}
+	return clst;
 }
@@ -6,12 +6,17 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/journal.h"
 #include "devices/disk.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
 
+static bool create (const char *name, off_t initial_size);
 static void do_format (void);
+#ifndef EFILESYS
+static void do_check (void);
+#endif
 
 /* Initializes the file system module.
  * If FORMAT is true, reformats the file system. */
@@ -22,6 +27,8 @@ filesys_init (bool format) {
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
 	inode_init ();
+	dir_init ();
+	journal_init ();
 
 	lock_init(&file_lock); // filesys.h에 선언 (P3)
 
@@ -31,6 +38,8 @@ filesys_init (bool format) {
 	if (format)
 		do_format ();
 
+	// FAT을 읽기 전에 journal을 replay함
+	journal_open ();
 	fat_open ();
 #else
 	/* Original FS */
@@ -39,7 +48,11 @@ filesys_init (bool format) {
 	if (format)
 		do_format ();
 
+	// journal을 replay하면 free map도 inode와 일치하므로 검사는 journal이 없을 때만
+	bool has_journal = journal_open ();
 	free_map_open ();
+	if (!has_journal && free_map_needs_check ())
+		do_check ();
 #endif
 }
 
@@ -53,6 +66,7 @@ filesys_done (void) {
 #else
 	free_map_close ();
 #endif
+	journal_close ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -61,15 +75,31 @@ filesys_done (void) {
  * or if internal memory allocation fails. */
 bool
 filesys_create (const char *name, off_t initial_size) {
+	bool success = create (name, initial_size);
+
+	// 공간이 모자랐다면 commit을 기다리던 sector가 free가 된 뒤 한 번 더 시도
+	if (!success && free_map_pending () && journal_commit ())
+		success = create (name, initial_size);
+	return success;
+}
+
+// filesys_create()의 본체, 연산 하나로 만듦
+static bool
+create (const char *name, off_t initial_size) {
 	disk_sector_t inode_sector = 0;
-	struct dir *dir = dir_open_root ();
-	bool success = (dir != NULL
+	struct dir *dir;
+	bool success;
+
+	journal_begin ();
+	dir = dir_open_root ();
+	success = (dir != NULL
 			&& free_map_allocate (1, &inode_sector)
 			&& inode_create (inode_sector, initial_size)
 			&& dir_add (dir, name, inode_sector));
 	if (!success && inode_sector != 0)
 		free_map_release (inode_sector, 1);
 	dir_close (dir);
+	journal_end ();
 
 	return success;
 }
@@ -97,10 +127,20 @@ filesys_open (const char *name) {
  * or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) {
-	struct dir *dir = dir_open_root ();
-	bool success = dir != NULL && dir_remove (dir, name);
+	struct inode *inode = NULL;
+	struct dir *dir;
+	bool success;
+
+	journal_begin ();
+	dir = dir_open_root ();
+	success = dir != NULL && dir_lookup (dir, name, &inode)
+		&& dir_remove (dir, name);
 	dir_close (dir);
+	journal_end ();
 
+	// 파일의 sector들은 마지막으로 닫힐 때 여러 연산으로 나누어 반납되므로
+	// 이 연산 안에서 닫히지 않도록 연산이 끝난 뒤에 닫음
+	inode_close (inode);
 	return success;
 }
 
@@ -112,9 +152,13 @@ do_format (void) {
 #ifdef EFILESYS
 	/* Create FAT and save it to the disk. */
 	fat_create ();
+	journal_create ();
+	if (!dir_create (ROOT_DIR_SECTOR, 16))
+		PANIC ("root directory creation failed");
 	fat_close ();
 #else
 	free_map_create ();
+	journal_create ();
 	if (!dir_create (ROOT_DIR_SECTOR, 16))
 		PANIC ("root directory creation failed");
 	free_map_close ();
@@ -122,3 +166,33 @@ do_format (void) {
 
 	printf ("done.\n");
 }
+
+#ifndef EFILESYS
+/* Rebuilds the free map from the files in the root directory,
+ * after the file system was not shut down cleanly. */
+static void
+do_check (void) {
+	struct dir *dir;
+	char name[NAME_MAX + 1];
+
+	printf ("Checking file system...");
+
+	dir = dir_open_root ();
+	if (dir == NULL)
+		PANIC ("can't open root directory");
+	free_map_rebuild_start ();
+	inode_mark_used (dir_get_inode (dir));
+	while (dir_readdir (dir, name)) {
+		struct inode *inode;
+
+		if (dir_lookup (dir, name, &inode)) {
+			inode_mark_used (inode);
+			inode_close (inode);
+		}
+	}
+	dir_close (dir);
+	free_map_rebuild_done ();
+
+	printf ("done.\n");
+}
+#endif
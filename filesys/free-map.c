@@ -1,13 +1,46 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <limits.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include <round.h>
+#include "threads/synch.h"
+#ifdef EFILESYS
+#include "filesys/fat.h"
+#endif
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
 
+/* Batched persistence (P3-EX).
+ * Allocations only change the in-memory free map and mark the
+ * sectors of the free map file that hold the changed bits as dirty.
+ * free_map_flush() writes just those sectors, and free_map_close()
+ * flushes and records a clean shutdown in a word stored right after
+ * the bitmap.  If that word is missing at mount, the on-disk free
+ * map may be stale and is rebuilt from the inodes instead. */
+#define FREE_MAP_CLEAN 0x434c454e    /* "CLEN": closed cleanly. */
+#define FREE_MAP_MOUNTED 0           /* In use, or crashed. */
+
+static struct lock free_map_lock;    /* Protects free_map and dirty. */
+static struct bitmap *dirty;         /* Dirty sectors of the free map file. */
+static bool needs_check;             /* Not closed cleanly last time. */
+
+/* Sectors released by a journal transaction are not reused until it
+ * is committed, so that a crash cannot leave them holding new data
+ * while the old metadata still refers to them.  Indexed by the
+ * parity of the transaction id, see journal_current(). */
+static struct bitmap *released[2];
+
+#ifndef EFILESYS
+static void mark_dirty (disk_sector_t sector, size_t cnt);
+static bool is_released (disk_sector_t sector, size_t cnt);
+#endif
+static bool write_state (uint32_t state);
+
 /* Initializes the free map. */
 void
 free_map_init (void) {
@@ -16,48 +49,263 @@ free_map_init (void) {
 		PANIC ("bitmap creation failed--disk is too large");
 	bitmap_mark (free_map, FREE_MAP_SECTOR);
 	bitmap_mark (free_map, ROOT_DIR_SECTOR);
+	bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+
+	released[0] = bitmap_create (disk_size (filesys_disk));
+	released[1] = bitmap_create (disk_size (filesys_disk));
+	if (released[0] == NULL || released[1] == NULL)
+		PANIC ("bitmap creation failed--disk is too large");
+
+	dirty = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+				DISK_SECTOR_SIZE));
+	if (dirty == NULL)
+		PANIC ("bitmap creation failed--disk is too large");
+	lock_init (&free_map_lock);
+}
+
+#ifdef EFILESYS
+/* With the FAT file system the free map is not used: sectors are
+ * handed out as runs of consecutive clusters, each run being one
+ * chain in the FAT. */
+bool
+free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
+	cluster_t clst;
+
+	if (cnt == 0) {
+		*sectorp = 0;
+		return true;
+	}
+	clst = fat_create_chain_multiple (0, DIV_ROUND_UP (cnt, SECTORS_PER_CLUSTER));
+	if (clst == 0)
+		return false;
+	*sectorp = cluster_to_sector (clst);
+	return true;
 }
 
+/* Allocates up to CNT free sectors starting exactly at SECTOR and
+ * returns how many were allocated.  SECTOR - 1 must be the last
+ * sector of an earlier allocation, whose chain is extended. */
+size_t
+free_map_allocate_at (disk_sector_t sector, size_t cnt) {
+	cluster_t clst = sector_to_cluster (sector);
+
+	ASSERT (SECTORS_PER_CLUSTER == 1);
+	if (cnt == 0 || clst <= 1)
+		return 0;
+	return fat_extend_chain (clst - 1, cnt);
+}
+
+/* Frees the CNT sectors starting at SECTOR, which must be the end of
+ * a run obtained from one free_map_allocate() call and any number of
+ * free_map_allocate_at() calls that extended it. */
+void
+free_map_release (disk_sector_t sector, size_t cnt) {
+	cluster_t clst = sector_to_cluster (sector);
+
+	if (cnt > 0) {
+		// run의 뒷부분만 반납한다면 앞 cluster에서 chain을 끊음
+		cluster_t prev = clst > 1 && fat_get (clst - 1) == clst ? clst - 1 : 0;
+		fat_remove_chain (clst, prev);
+	}
+}
+#else
 /* Allocates CNT consecutive sectors from the free map and stores
  * the first into *SECTORP.
  * Returns true if successful, false if all sectors were
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-	if (sector != BITMAP_ERROR
-			&& free_map_file != NULL
-			&& !bitmap_write (free_map, free_map_file)) {
-		bitmap_set_multiple (free_map, sector, cnt, false);
-		sector = BITMAP_ERROR;
+	size_t sector = 0;
+
+	lock_acquire (&free_map_lock);
+	// commit되지 않은 transaction이 반납한 sector는 건너뜀
+	for (;;) {
+		sector = bitmap_scan (free_map, sector, cnt, false);
+		if (sector == BITMAP_ERROR || !is_released (sector, cnt))
+			break;
+		sector++;
 	}
-	if (sector != BITMAP_ERROR)
+	if (sector != BITMAP_ERROR) {
+		bitmap_set_multiple (free_map, sector, cnt, true);
+		mark_dirty (sector, cnt);
 		*sectorp = sector;
+	}
+	lock_release (&free_map_lock);
 	return sector != BITMAP_ERROR;
 }
 
+/* Allocates up to CNT free sectors starting exactly at SECTOR and
+ * returns how many were allocated. */
+size_t
+free_map_allocate_at (disk_sector_t sector, size_t cnt) {
+	size_t bit_cnt = bitmap_size (free_map);
+	size_t got = 0;
+
+	lock_acquire (&free_map_lock);
+	while (got < cnt && sector + got < bit_cnt
+			&& !bitmap_test (free_map, sector + got)
+			&& !is_released (sector + got, 1))
+		got++;
+	if (got > 0) {
+		bitmap_set_multiple (free_map, sector, got, true);
+		mark_dirty (sector, got);
+	}
+	lock_release (&free_map_lock);
+	return got;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
+	lock_acquire (&free_map_lock);
 	ASSERT (bitmap_all (free_map, sector, cnt));
 	bitmap_set_multiple (free_map, sector, cnt, false);
-	bitmap_write (free_map, free_map_file);
+	mark_dirty (sector, cnt);
+	if (journal_enabled ())
+		bitmap_set_multiple (released[journal_current () % 2], sector, cnt, true);
+	lock_release (&free_map_lock);
+}
+
+/* Returns true if the free map was not closed cleanly when the
+ * file system was last used, so that it may not match the inodes
+ * and must be rebuilt with free_map_rebuild_start(),
+ * free_map_mark() and free_map_rebuild_done(). */
+bool
+free_map_needs_check (void) {
+	return needs_check;
+}
+
+/* Starts rebuilding the free map: only the system sectors and the
+ * free map file itself are left marked. */
+void
+free_map_rebuild_start (void) {
+	bitmap_set_all (free_map, false);
+	bitmap_mark (free_map, FREE_MAP_SECTOR);
+	bitmap_mark (free_map, ROOT_DIR_SECTOR);
+	bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+	inode_mark_used (file_get_inode (free_map_file));
+}
+
+/* Marks CNT sectors starting at SECTOR as in use while rebuilding. */
+void
+free_map_mark (disk_sector_t sector, size_t cnt) {
+	bitmap_set_multiple (free_map, sector, cnt, true);
+}
+
+/* Finishes rebuilding the free map and writes all of it to disk. */
+void
+free_map_rebuild_done (void) {
+	bitmap_set_all (dirty, true);
+	free_map_flush ();
+	needs_check = false;
+}
+
+// SECTOR부터 CNT개 sector의 bit가 들어있는 free map 파일의 sector를 dirty로 표시
+// free_map_lock을 잡은 상태로 호출
+static void
+mark_dirty (disk_sector_t sector, size_t cnt) {
+	size_t first, last;
+
+	if (cnt == 0)
+		return;
+	first = sector / CHAR_BIT / DISK_SECTOR_SIZE;
+	last = (sector + cnt - 1) / CHAR_BIT / DISK_SECTOR_SIZE;
+	bitmap_set_multiple (dirty, first, last - first + 1, true);
+}
+
+// SECTOR부터 CNT개 중 commit되지 않은 transaction이 반납한 sector가 있는지 여부
+// free_map_lock을 잡은 상태로 호출
+static bool
+is_released (disk_sector_t sector, size_t cnt) {
+	return bitmap_any (released[0], sector, cnt)
+		|| bitmap_any (released[1], sector, cnt);
+}
+#endif
+
+/* Writes the dirty sectors of the free map to disk. */
+void
+free_map_flush (void) {
+#ifdef EFILESYS
+	// FAT에서는 바뀐 FAT sector를 기록
+	fat_flush ();
+#else
+	size_t i;
+
+	if (free_map_file == NULL)
+		return;
+
+	// 기록하는 동안 바뀐 bit는 다시 dirty가 되어 다음 flush에서 기록됨
+	for (i = 0; i < bitmap_size (dirty); i++) {
+		bool is_dirty;
+
+		lock_acquire (&free_map_lock);
+		is_dirty = bitmap_test (dirty, i);
+		bitmap_reset (dirty, i);
+		lock_release (&free_map_lock);
+		if (is_dirty && !bitmap_write_range (free_map, free_map_file,
+					i * DISK_SECTOR_SIZE, DISK_SECTOR_SIZE))
+			PANIC ("can't write free map");
+	}
+#endif
+}
+
+/* Called when journal transaction ID has been committed: the
+ * sectors it released may now be allocated again. */
+void
+free_map_committed (uint32_t id) {
+#ifdef EFILESYS
+	fat_committed (id);
+#else
+	lock_acquire (&free_map_lock);
+	bitmap_set_all (released[id % 2], false);
+	lock_release (&free_map_lock);
+#endif
+}
+
+/* Returns true if some sectors are released but cannot be
+ * allocated until the running transaction is committed. */
+bool
+free_map_pending (void) {
+#ifdef EFILESYS
+	return fat_pending ();
+#else
+	bool pending;
+
+	lock_acquire (&free_map_lock);
+	pending = bitmap_any (released[0], 0, bitmap_size (released[0]))
+		|| bitmap_any (released[1], 0, bitmap_size (released[1]));
+	lock_release (&free_map_lock);
+	return pending;
+#endif
 }
 
 /* Opens the free map file and reads it from disk. */
 void
 free_map_open (void) {
+	uint32_t state = FREE_MAP_MOUNTED;
+
 	free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
 	if (free_map_file == NULL)
 		PANIC ("can't open free map");
+	inode_set_metadata (file_get_inode (free_map_file));
 	if (!bitmap_read (free_map, free_map_file))
 		PANIC ("can't read free map");
+
+	// 깨끗하게 닫히지 않았다면 검사가 필요함, 다시 닫을 때까지는 사용중으로 기록
+	file_read_at (free_map_file, &state, sizeof state, bitmap_file_size (free_map));
+	needs_check = state != FREE_MAP_CLEAN;
+	if (!write_state (FREE_MAP_MOUNTED))
+		PANIC ("can't write free map");
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) {
+	free_map_flush ();
+	if (!write_state (FREE_MAP_CLEAN))
+		PANIC ("can't write free map");
 	file_close (free_map_file);
+	free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -72,6 +320,16 @@ free_map_create (void) {
 	free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
 	if (free_map_file == NULL)
 		PANIC ("can't open free map");
+	inode_set_metadata (file_get_inode (free_map_file));
+	if (!write_state (FREE_MAP_MOUNTED))
+		PANIC ("can't write free map");
 	if (!bitmap_write (free_map, free_map_file))
 		PANIC ("can't write free map");
 }
+
+// bitmap 바로 뒤의 상태 word를 기록함
+static bool
+write_state (uint32_t state) {
+	return file_write_at (free_map_file, &state, sizeof state,
+			bitmap_file_size (free_map)) == sizeof state;
+}
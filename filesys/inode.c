@@ -1,22 +1,55 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* A run of file data (P3-EX).
+ * File sectors LOFS to LOFS + LEN - 1 are stored on the consecutive
+ * disk sectors starting at START. */
+struct extent {
+	uint32_t lofs;                      /* First file sector. */
+	disk_sector_t start;                /* First disk sector. */
+	uint32_t len;                       /* Number of sectors. */
+};
+
+#define INODE_EXTENTS 41                /* Extents in the inode itself. */
+#define BLOCK_EXTENTS 42                /* Extents in each extent block. */
+
+/* Bounds on what one journal operation changes, so that it stays
+ * below JOURNAL_OP_MAX sectors: adding an extent may rewrite the
+ * inode and every extent block, a write allocates at most
+ * WRITE_BATCH runs, and each step of freeing a removed inode
+ * changes at most RELEASE_BATCH free map or FAT sectors. */
+#define MAX_BLOCKS 24                   /* Extent blocks per inode. */
+#define WRITE_BATCH 8                   /* Sectors written per operation. */
+#define RELEASE_BATCH 16                /* Sectors changed per freeing step. */
+
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[125];               /* Not used. */
+	uint32_t extent_cnt;                /* Number of extents. */
+	disk_sector_t ext_block;            /* First extent block, 0 if none. */
+	struct extent extents[INODE_EXTENTS]; /* First extents, sorted by lofs. */
+	uint32_t unused[1];                 /* Not used. */
+};
+
+/* On-disk block holding the extents that do not fit in the inode.
+ * Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct extent_block {
+	disk_sector_t next;                 /* Next extent block, 0 if none. */
+	struct extent extents[BLOCK_EXTENTS];
+	uint32_t unused[1];                 /* Not used. */
 };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -28,35 +61,79 @@ bytes_to_sectors (off_t size) {
 
 /* In-memory inode. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
+	struct hash_elem elem;              /* Element in open_inodes. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
+	bool bad;                           /* True if loading failed. */
 	bool removed;                       /* True if deleted, false otherwise. */
+	bool metadata;                      /* Data is written through the journal. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
+
+	// P3-EX: extent map
+	struct lock lock;                   /* Protects the fields below.
+	                                       Held while the inode is loaded. */
+	struct extent *extents;             /* All extents, sorted by lofs. */
+	size_t ext_cap;                     /* Capacity of EXTENTS. */
+	size_t ext_hint;                    /* Extent used by the last lookup. */
+	disk_sector_t *blocks;              /* Sectors of the extent blocks. */
+	size_t block_cnt;
 };
 
+static size_t extent_index (struct inode *, uint32_t sector);
+static struct extent *find_extent (struct inode *, uint32_t sector);
+static disk_sector_t map_sector (struct inode *, uint32_t sector,
+		uint32_t end, size_t *new_cnt);
+static void set_length (struct inode *, off_t length);
+static size_t alloc_sectors (struct inode *, uint32_t lofs, size_t cnt);
+static bool insert_extent (struct inode *, size_t idx, uint32_t lofs,
+		disk_sector_t start, size_t cnt);
+static bool load_extents (struct inode *);
+static bool flush_extents (struct inode *, size_t from);
+static bool free_extents (struct inode *);
+static size_t release_cost (size_t cnt);
+static void write_data (struct inode *, disk_sector_t, const void *);
+static off_t write_at (struct inode *, const uint8_t *, off_t size,
+		off_t offset);
+static off_t write_batch (struct inode *, const uint8_t *, off_t size,
+		off_t offset);
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
- * POS. */
+ * POS, either because POS is past end of file or because it lies
+ * in a hole that has never been written. */
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) {
+byte_to_sector (struct inode *inode, off_t pos) {
+	disk_sector_t sector = -1;
+	struct extent *e;
+
 	ASSERT (inode != NULL);
-	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
-	else
+	if (pos >= inode->data.length)
 		return -1;
+
+	lock_acquire (&inode->lock);
+	e = find_extent (inode, pos / DISK_SECTOR_SIZE);
+	if (e != NULL)
+		sector = e->start + (pos / DISK_SECTOR_SIZE - e->lofs);
+	lock_release (&inode->lock);
+	return sector;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes hashed by sector, so that opening a single inode
+ * twice returns the same `struct inode'. */
+static struct hash open_inodes;
+static struct lock open_inodes_lock;   /* Protects open_inodes, open_cnt. */
+
+static uint64_t inode_hash (const struct hash_elem *, void *);
+static bool inode_less (const struct hash_elem *, const struct hash_elem *,
+		void *);
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	hash_init (&open_inodes, inode_hash, inode_less, NULL);
+	lock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -74,23 +151,17 @@ inode_create (disk_sector_t sector, off_t length) {
 	/* If this assertion fails, the inode structure is not exactly
 	 * one sector in size, and you should fix that. */
 	ASSERT (sizeof *disk_inode == DISK_SECTOR_SIZE);
+	ASSERT (sizeof (struct extent_block) == DISK_SECTOR_SIZE);
 
+	// 데이터 sector는 처음 쓸 때 할당하므로 (sparse file) inode만 기록함
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
-		size_t sectors = bytes_to_sectors (length);
 		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-				size_t i;
-
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
-			}
-			success = true; 
-		} 
+		journal_begin ();
+		journal_write (sector, disk_inode);
+		journal_end ();
+		success = true;
 		free (disk_inode);
 	}
 	return success;
@@ -101,39 +172,73 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
+	struct inode key;
+	struct hash_elem *e;
 	struct inode *inode;
+	bool loaded;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
+	key.sector = sector;
+	lock_acquire (&open_inodes_lock);
+	e = hash_find (&open_inodes, &key.elem);
+	if (e != NULL) {
+		inode = hash_entry (e, struct inode, elem);
+		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+
+		// 처음 연 쓰레드가 디스크에서 읽어오는 중이라면 끝날 때까지 기다림
+		lock_acquire (&inode->lock);
+		lock_release (&inode->lock);
+		if (inode->bad) {
+			inode_close (inode);
+			return NULL;
 		}
+		return inode;
 	}
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	if (inode == NULL) {
+		lock_release (&open_inodes_lock);
 		return NULL;
+	}
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  The inode is published before it is read from
+	 * disk, with its lock held so that other openers wait. */
 	inode->sector = sector;
 	inode->open_cnt = 1;
+	inode->bad = false;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	inode->metadata = false;
+	lock_init (&inode->lock);
+	lock_acquire (&inode->lock);
+	inode->extents = NULL;
+	inode->ext_cap = inode->ext_hint = 0;
+	inode->blocks = NULL;
+	inode->block_cnt = 0;
+	hash_insert (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
+
+	journal_read (inode->sector, &inode->data);
+	loaded = load_extents (inode);
+	inode->bad = !loaded;
+	lock_release (&inode->lock);
+	if (!loaded) {
+		inode_close (inode);
+		return NULL;
+	}
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -148,23 +253,35 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
+	lock_acquire (&open_inodes_lock);
+	last = --inode->open_cnt == 0;
+	if (last)
+		hash_delete (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
 
+	if (last) {
 		/* Deallocate blocks if removed. */
-		if (inode->removed) {
-			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
+		if (inode->removed && !inode->bad) {
+			bool more;
+
+			// 큰 파일도 연산 하나가 journal을 넘지 않도록 여러 연산으로 나누어 반납
+			do {
+				journal_begin ();
+				more = free_extents (inode);
+				journal_end ();
+			} while (more);
 		}
 
-		free (inode); 
+		free (inode->extents);
+		free (inode->blocks);
+		free (inode);
 	}
 }
 
@@ -200,9 +317,12 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
+		if (sector_idx == (disk_sector_t) -1) {
+			/* Hole that has never been written reads as zeros. */
+			memset (buffer + bytes_read, 0, chunk_size);
+		} else if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
 			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
+			journal_read (sector_idx, buffer + bytes_read);
 		} else {
 			/* Read sector into bounce buffer, then partially copy
 			 * into caller's buffer. */
@@ -211,7 +331,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 				if (bounce == NULL)
 					break;
 			}
-			disk_read (filesys_disk, sector_idx, bounce);
+			journal_read (sector_idx, bounce);
 			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
 		}
 
@@ -226,38 +346,82 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * Extends INODE if the write goes past end of file.
  * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * less than SIZE if disk space runs out or an error occurs. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
-	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
+	off_t bytes_written;
 
 	if (inode->deny_write_cnt)
 		return 0;
 
+	bytes_written = write_at (inode, buffer, size, offset);
+	// 공간이 모자랐다면 commit을 기다리던 sector가 free가 된 뒤 나머지를 씀
+	if (bytes_written < size && free_map_pending () && journal_commit ())
+		bytes_written += write_at (inode, buffer + bytes_written,
+				size - bytes_written, offset + bytes_written);
+	return bytes_written;
+}
+
+// inode_write_at()의 본체
+// 연산 하나가 journal을 넘지 않도록 WRITE_BATCH개 sector씩 나누어 씀
+static off_t
+write_at (struct inode *inode, const uint8_t *buffer, off_t size,
+		off_t offset) {
+	off_t bytes_written = 0;
+
+	while (bytes_written < size) {
+		off_t ofs = offset + bytes_written;
+		off_t batch_end = (ofs / DISK_SECTOR_SIZE + WRITE_BATCH) * DISK_SECTOR_SIZE;
+		off_t n = size - bytes_written < batch_end - ofs
+			? size - bytes_written : batch_end - ofs;
+		off_t written = write_batch (inode, buffer + bytes_written, n, ofs);
+
+		bytes_written += written;
+		if (written < n)
+			break;
+	}
+	return bytes_written;
+}
+
+// 연산 하나로 씀
+static off_t
+write_batch (struct inode *inode, const uint8_t *buffer, off_t size,
+		off_t offset) {
+	off_t bytes_written = 0;
+	uint8_t *bounce = NULL;
+	uint32_t end = DIV_ROUND_UP (offset + size, DISK_SECTOR_SIZE);
+	uint32_t fresh_start = 0, fresh_end = 0;
+
+	journal_begin ();
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
-		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		uint32_t sector_no = offset / DISK_SECTOR_SIZE;
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
-
-		/* Bytes left in inode, bytes left in sector, lesser of the two. */
-		off_t inode_left = inode_length (inode) - offset;
 		int sector_left = DISK_SECTOR_SIZE - sector_ofs;
-		int min_left = inode_left < sector_left ? inode_left : sector_left;
+		size_t new_cnt;
+		disk_sector_t sector_idx;
 
-		/* Number of bytes to actually write into this sector. */
-		int chunk_size = size < min_left ? size : min_left;
-		if (chunk_size <= 0)
+		/* Number of bytes to actually write into this sector.
+		   Writing past end of file extends the file. */
+		int chunk_size = size < sector_left ? size : sector_left;
+
+		/* A hole gets sectors on its first write, as many as the rest
+		   of this write needs at once so that they stay contiguous. */
+		sector_idx = map_sector (inode, sector_no, end, &new_cnt);
+		if (sector_idx == (disk_sector_t) -1)
 			break;
+		if (new_cnt > 0) {
+			fresh_start = sector_no;
+			fresh_end = sector_no + new_cnt;
+		}
 
 		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
 			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
+			write_data (inode, sector_idx, buffer + bytes_written);
 		} else {
 			/* We need a bounce buffer. */
 			if (bounce == NULL) {
@@ -268,13 +432,15 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
 			/* If the sector contains data before or after the chunk
 			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
+			   first.  Otherwise we start with a sector of all zeros.
+			   A sector just taken for a hole has no data yet. */
+			if ((sector_ofs > 0 || chunk_size < sector_left)
+					&& !(fresh_start <= sector_no && sector_no < fresh_end))
+				journal_read (sector_idx, bounce);
 			else
 				memset (bounce, 0, DISK_SECTOR_SIZE);
 			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
+			write_data (inode, sector_idx, bounce);
 		}
 
 		/* Advance. */
@@ -284,6 +450,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	}
 	free (bounce);
 
+	if (offset > inode_length (inode))
+		set_length (inode, offset);
+	journal_end ();
 	return bytes_written;
 }
 
@@ -311,3 +480,340 @@ off_t
 inode_length (const struct inode *inode) {
 	return inode->data.length;
 }
+
+/* Marks INODE as holding file system metadata, such as a directory
+ * or the free map, whose data is written through the journal
+ * along with the inode itself. */
+void
+inode_set_metadata (struct inode *inode) {
+	inode->metadata = true;
+}
+
+#ifndef EFILESYS
+/* Marks every sector used by INODE, including the inode itself and
+ * its extent blocks, in the free map being rebuilt. */
+void
+inode_mark_used (struct inode *inode) {
+	size_t i;
+
+	lock_acquire (&inode->lock);
+	free_map_mark (inode->sector, 1);
+	for (i = 0; i < inode->data.extent_cnt; i++)
+		free_map_mark (inode->extents[i].start, inode->extents[i].len);
+	for (i = 0; i < inode->block_cnt; i++)
+		free_map_mark (inode->blocks[i], 1);
+	lock_release (&inode->lock);
+}
+#endif
+
+// ===== [Open inodes] =====
+
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct inode, elem)->sector
+		< hash_entry (b, struct inode, elem)->sector;
+}
+
+// ===== [Extent map] =====
+
+// SECTOR번째 파일 sector를 담은 extent, 없다면 NULL
+// 순차 접근이 대부분이므로 지난번 extent와 그 다음 extent를 먼저 확인하고
+// 아니라면 lofs로 binary search함, inode->lock을 잡은 상태로 호출
+static struct extent *
+find_extent (struct inode *inode, uint32_t sector) {
+	size_t cnt = inode->data.extent_cnt;
+	struct extent *e;
+	size_t i;
+
+	for (i = inode->ext_hint; i < cnt && i <= inode->ext_hint + 1; i++) {
+		e = &inode->extents[i];
+		if (e->lofs <= sector && sector < e->lofs + e->len) {
+			inode->ext_hint = i;
+			return e;
+		}
+	}
+
+	// lofs <= SECTOR인 마지막 extent를 확인
+	i = extent_index (inode, sector);
+	if (i == 0)
+		return NULL;
+	e = &inode->extents[i - 1];
+	if (sector >= e->lofs + e->len)
+		return NULL;
+	inode->ext_hint = i - 1;
+	return e;
+}
+
+// lofs <= SECTOR인 extent의 수 (binary search)
+// 즉 SECTOR에서 시작하는 extent가 들어갈 위치, inode->lock을 잡은 상태로 호출
+static size_t
+extent_index (struct inode *inode, uint32_t sector) {
+	size_t lo = 0, hi = inode->data.extent_cnt;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (inode->extents[mid].lofs <= sector)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// SECTOR번째 파일 sector의 디스크 sector, hole이라면 END까지 (다음 extent 전까지)
+// sector를 할당하고 새로 할당한 수를 *NEW_CNT에 저장함
+// 할당에 실패하면 -1
+static disk_sector_t
+map_sector (struct inode *inode, uint32_t sector, uint32_t end,
+		size_t *new_cnt) {
+	disk_sector_t disk_sector = -1;
+	struct extent *e;
+
+	*new_cnt = 0;
+	lock_acquire (&inode->lock);
+	e = find_extent (inode, sector);
+	if (e == NULL) {
+		size_t idx = extent_index (inode, sector);
+
+		if (idx < inode->data.extent_cnt && inode->extents[idx].lofs < end)
+			end = inode->extents[idx].lofs;
+		*new_cnt = alloc_sectors (inode, sector, end - sector);
+		flush_extents (inode, idx > 0 ? idx - 1 : 0);
+		e = find_extent (inode, sector);
+	}
+	if (e != NULL)
+		disk_sector = e->start + (sector - e->lofs);
+	lock_release (&inode->lock);
+	return disk_sector;
+}
+
+// 파일 길이를 LENGTH로 늘리고 inode를 기록함
+static void
+set_length (struct inode *inode, off_t length) {
+	lock_acquire (&inode->lock);
+	if (length > inode->data.length) {
+		inode->data.length = length;
+		flush_extents (inode, inode->data.extent_cnt);
+	}
+	lock_release (&inode->lock);
+}
+
+// hole인 파일 sector LOFS부터 CNT개를 할당하고 할당한 수를 반환함
+// 가능하면 바로 앞 extent를 그대로 늘려 파일이 디스크에 연속으로 놓이게 함
+// 0으로 채우지 않으므로 호출한 쪽에서 바로 데이터를 써야 함
+static size_t
+alloc_sectors (struct inode *inode, uint32_t lofs, size_t cnt) {
+	size_t done = 0;
+
+	while (done < cnt) {
+		size_t idx = extent_index (inode, lofs);
+		struct extent *prev = idx > 0 ? &inode->extents[idx - 1] : NULL;
+		disk_sector_t start;
+		size_t got = 0;
+
+		// 앞 extent 바로 뒤의 sector들이 비어있다면 그 extent를 늘림
+		if (prev != NULL && prev->lofs + prev->len == lofs) {
+			got = free_map_allocate_at (prev->start + prev->len, cnt - done);
+			prev->len += got;
+		}
+
+		if (got == 0) {
+			// 연속된 sector가 모자라면 절반씩 줄여가며 할당함
+			got = cnt - done;
+			while (!free_map_allocate (got, &start)) {
+				if (got == 1)
+					return done;
+				got = DIV_ROUND_UP (got, 2);
+			}
+			if (!insert_extent (inode, idx, lofs, start, got)) {
+				free_map_release (start, got);
+				return done;
+			}
+		}
+
+		lofs += got;
+		done += got;
+	}
+	return done;
+}
+
+// IDX번째 자리에 새 extent를 끼워넣음, 필요하면 extent block도 할당
+static bool
+insert_extent (struct inode *inode, size_t idx, uint32_t lofs,
+		disk_sector_t start, size_t cnt) {
+	size_t ext_cnt = inode->data.extent_cnt;
+
+	if (ext_cnt == inode->ext_cap) {
+		size_t cap = inode->ext_cap ? inode->ext_cap * 2 : INODE_EXTENTS;
+		struct extent *extents = realloc (inode->extents, cap * sizeof *extents);
+		if (extents == NULL)
+			return false;
+		inode->extents = extents;
+		inode->ext_cap = cap;
+	}
+
+	// inode와 extent block들에 더 들어갈 자리가 없다면 block을 하나 추가
+	if (ext_cnt >= INODE_EXTENTS + inode->block_cnt * BLOCK_EXTENTS) {
+		disk_sector_t *blocks;
+		disk_sector_t sector;
+
+		if (inode->block_cnt >= MAX_BLOCKS)
+			return false;
+		// sector를 먼저 할당해서, 실패하면 inode 상태를 건드리지 않고 돌아감
+		if (!free_map_allocate (1, &sector))
+			return false;
+		blocks = realloc (inode->blocks, (inode->block_cnt + 1) * sizeof *blocks);
+		if (blocks == NULL) {
+			free_map_release (sector, 1);
+			return false;
+		}
+		inode->blocks = blocks;
+		inode->blocks[inode->block_cnt++] = sector;
+	}
+
+	memmove (&inode->extents[idx + 1], &inode->extents[idx],
+			(ext_cnt - idx) * sizeof *inode->extents);
+	inode->extents[idx] = (struct extent) {
+		.lofs = lofs,
+		.start = start,
+		.len = cnt,
+	};
+	inode->data.extent_cnt++;
+	inode->ext_hint = idx;
+	return true;
+}
+
+// inode와 extent block들을 읽어 inode->extents를 채움
+static bool
+load_extents (struct inode *inode) {
+	size_t cnt = inode->data.extent_cnt;
+	disk_sector_t next = inode->data.ext_block;
+	struct extent_block *block = NULL;
+	size_t i;
+
+	inode->ext_cap = cnt > INODE_EXTENTS ? cnt : INODE_EXTENTS;
+	inode->extents = malloc (inode->ext_cap * sizeof *inode->extents);
+	if (inode->extents == NULL)
+		return false;
+	memcpy (inode->extents, inode->data.extents,
+			(cnt < INODE_EXTENTS ? cnt : INODE_EXTENTS) * sizeof *inode->extents);
+	if (next == 0)
+		return true;
+
+	block = malloc (sizeof *block);
+	if (block == NULL)
+		return false;
+	for (i = INODE_EXTENTS; next != 0; i += BLOCK_EXTENTS) {
+		disk_sector_t *blocks = realloc (inode->blocks,
+				(inode->block_cnt + 1) * sizeof *blocks);
+		size_t n = i < cnt ? cnt - i : 0;
+
+		if (n > BLOCK_EXTENTS)
+			n = BLOCK_EXTENTS;
+		if (blocks == NULL) {
+			free (block);
+			return false;
+		}
+		inode->blocks = blocks;
+		blocks[inode->block_cnt++] = next;
+		journal_read (next, block);
+		memcpy (&inode->extents[i], block->extents, n * sizeof *block->extents);
+		next = block->next;
+	}
+	free (block);
+	return true;
+}
+
+// inode 자체와 FROM번째 이후의 extent를 담은 extent block들을 기록함
+static bool
+flush_extents (struct inode *inode, size_t from) {
+	size_t cnt = inode->data.extent_cnt;
+	struct extent_block *block;
+	size_t b;
+
+	memcpy (inode->data.extents, inode->extents,
+			(cnt < INODE_EXTENTS ? cnt : INODE_EXTENTS) * sizeof *inode->extents);
+	inode->data.ext_block = inode->block_cnt > 0 ? inode->blocks[0] : 0;
+	journal_write (inode->sector, &inode->data);
+	if (inode->block_cnt == 0)
+		return true;
+
+	block = calloc (1, sizeof *block);
+	if (block == NULL)
+		return false;
+	for (b = 0; b < inode->block_cnt; b++) {
+		size_t first = INODE_EXTENTS + b * BLOCK_EXTENTS;
+		size_t n = first < cnt ? cnt - first : 0;
+
+		// FROM 이전의 extent만 담은 block은 바뀌지 않았음
+		// (새 block이 추가되면 FROM은 앞 block의 마지막 extent이므로 앞 block의 next도 기록됨)
+		if (first + BLOCK_EXTENTS <= from)
+			continue;
+		if (n > BLOCK_EXTENTS)
+			n = BLOCK_EXTENTS;
+		memset (block, 0, sizeof *block);
+		memcpy (block->extents, &inode->extents[first], n * sizeof *block->extents);
+		block->next = b + 1 < inode->block_cnt ? inode->blocks[b + 1] : 0;
+		journal_write (inode->blocks[b], block);
+	}
+	free (block);
+	return true;
+}
+
+// 파일 끝부터 extent, extent block, 마지막으로 inode sector를 반납함
+// 바뀌는 free map 또는 FAT sector가 RELEASE_BATCH개를 넘기 전에 멈추고
+// 아직 반납할 것이 남았다면 true 반환
+static bool
+free_extents (struct inode *inode) {
+	size_t budget = RELEASE_BATCH;
+
+	inode->ext_hint = 0;
+	while (inode->data.extent_cnt > 0) {
+		struct extent *e = &inode->extents[inode->data.extent_cnt - 1];
+		size_t cnt = e->len;
+
+		// 너무 긴 extent는 뒷부분부터 남은 만큼만 반납
+		if (release_cost (cnt) > budget)
+			cnt = budget > release_cost (0)
+				? (budget - release_cost (0)) * (DISK_SECTOR_SIZE / sizeof (uint32_t)) : 0;
+		if (cnt == 0)
+			return true;
+		free_map_release (e->start + e->len - cnt, cnt);
+		budget -= release_cost (cnt);
+		e->len -= cnt;
+		if (e->len == 0)
+			inode->data.extent_cnt--;
+	}
+	while (inode->block_cnt > 0) {
+		if (release_cost (1) > budget)
+			return true;
+		free_map_release (inode->blocks[--inode->block_cnt], 1);
+		budget -= release_cost (1);
+	}
+	if (release_cost (1) > budget)
+		return true;
+	free_map_release (inode->sector, 1);
+	return false;
+}
+
+// 연속된 CNT개 sector를 반납할 때 바뀔 수 있는 free map 또는 FAT sector 수
+// FAT entry가 4 bytes로 더 크므로 FAT 기준, 앞 cluster의 entry도 바뀔 수 있음
+static size_t
+release_cost (size_t cnt) {
+	return cnt / (DISK_SECTOR_SIZE / sizeof (uint32_t)) + 2;
+}
+
+// 데이터 sector를 기록함, metadata라면 journal을 거침
+static void
+write_data (struct inode *inode, disk_sector_t sector, const void *buffer) {
+	if (inode->metadata)
+		journal_write (sector, buffer);
+	else
+		disk_write (filesys_disk, sector, buffer);
+}
@@ -0,0 +1,547 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Metadata journal (P3-EX).
+ * 디스크의 JOURNAL_SECTOR부터 JOURNAL_SECTORS개 sector를 사용함.
+ *
+ *   JOURNAL_SECTOR       superblock: 다음 transaction의 seq
+ *   JOURNAL_SECTOR + 1   descriptor: seq, 기록된 sector JOURNAL_TAGS개까지의 원래 위치
+ *   그 다음 sector들      기록된 sector들의 내용
+ *   ...                  transaction이 크다면 다시 descriptor와 내용
+ *   그 다음 sector       commit record: seq, 전체 개수, checksum
+ *
+ * metadata 쓰기는 메모리의 running transaction에 모이고 (같은 sector는 한 번만),
+ * journald가 주기적으로 또는 일정 크기가 넘으면 이를 한꺼번에 commit함.
+ * commit record까지 기록된 뒤에야 원래 위치에 쓰고 (checkpoint),
+ * 끝나면 superblock의 seq를 올려 journal을 비움.
+ * mount 시에는 superblock의 seq와 같은 온전한 transaction이 있으면 replay함.
+ *
+ * 파일 시스템 연산 하나는 journal_begin()과 journal_end() 사이에서 이루어지며,
+ * commit은 진행중인 연산이 하나도 없을 때의 running transaction을 가져감.
+ * 연산 하나는 JOURNAL_OP_MAX개 sector까지만 기록하므로 (큰 파일의 쓰기와 삭제는
+ * 여러 연산으로 나뉨), 새 연산은 진행중인 연산들과 자신이 모두 그만큼 기록해도
+ * journal 영역에 들어갈 때만 시작하고 아니면 commit한 뒤에 시작함.  running
+ * transaction이 JOURNAL_HIGH개를 넘었을 때도 마찬가지임.  단 page의 write-back처럼
+ * 다른 연산이 기다릴 수 있는 쓰기는 journal_begin_nowait()으로 기다리지 않고 시작함. */
+
+#define JOURNAL_MAGIC 0x4a524e4c        /* "JRNL": superblock. */
+#define DESC_MAGIC 0x4a444553           /* "JDES": descriptor. */
+#define COMMIT_MAGIC 0x4a434d54         /* "JCMT": commit record. */
+#define JOURNAL_TAGS 125                /* Sectors per descriptor. */
+#define JOURNAL_HIGH (JOURNAL_TAGS / 2) /* Commit before new work above this. */
+/* Most sectors one transaction may hold: the journal also needs the
+ * superblock, a descriptor per JOURNAL_TAGS sectors and the commit
+ * record. */
+#define JOURNAL_ROOM (JOURNAL_SECTORS - 2 \
+		- DIV_ROUND_UP (JOURNAL_SECTORS, JOURNAL_TAGS + 1))
+#define JOURNAL_POLL_TICKS 10           /* How often journald checks. */
+#define JOURNAL_COMMIT_TICKS 500        /* Longest a change stays in memory. */
+
+/* Journal superblock, at JOURNAL_SECTOR. */
+struct journal_super {
+	unsigned magic;                     /* JOURNAL_MAGIC. */
+	uint32_t seq;                       /* Seq of the next transaction. */
+	uint8_t unused[504];                /* Not used. */
+};
+
+/* Transaction descriptor, at JOURNAL_SECTOR + 1 and after every
+ * JOURNAL_TAGS logged sectors. */
+struct journal_desc {
+	unsigned magic;                     /* DESC_MAGIC. */
+	uint32_t seq;                       /* Transaction seq. */
+	uint32_t cnt;                       /* Number of sectors. */
+	disk_sector_t sectors[JOURNAL_TAGS]; /* Home location of each sector. */
+};
+
+/* Commit record, right after the last logged sector. */
+struct journal_commit {
+	unsigned magic;                     /* COMMIT_MAGIC. */
+	uint32_t seq;                       /* Transaction seq. */
+	uint32_t cnt;                       /* Number of sectors, in all descriptors. */
+	uint32_t checksum;                  /* Of the logged sectors. */
+	uint8_t unused[496];                /* Not used. */
+};
+
+/* A sector changed by a transaction. */
+struct jbuf {
+	struct hash_elem elem;              /* Element in txn->bufs. */
+	struct list_elem list_elem;         /* Element in txn->order. */
+	disk_sector_t sector;               /* Home location. */
+	uint8_t data[DISK_SECTOR_SIZE];     /* New contents. */
+};
+
+/* An in-memory transaction: every operation between two commits. */
+struct txn {
+	uint32_t id;                        /* See journal_current(). */
+	struct hash bufs;                   /* struct jbuf by sector. */
+	struct list order;                  /* struct jbuf in order of first write. */
+	size_t cnt;                         /* Number of sectors. */
+	int64_t start;                      /* Tick of the first write. */
+};
+
+bool journal_crash;
+
+static bool enabled;                 /* Writes go through the journal. */
+static uint32_t seq;                 /* Seq of the next transaction on disk. */
+
+static struct lock journal_lock;     /* Protects the fields below. */
+static struct txn txns[2];
+static struct txn *running;          /* Receives new writes. */
+static struct txn *committing;       /* Being written, NULL if none. */
+static int handle_cnt;               /* Operations in progress. */
+static struct condition handles_done; /* Signaled when HANDLE_CNT gets 0. */
+
+static struct lock commit_lock;      /* One commit at a time. */
+
+static void begin (bool wait);
+static bool has_room (void);
+static bool may_wait (void);
+static void journald (void *aux);
+static void commit (bool checkpoint);
+static void write_txn (struct txn *, bool checkpoint);
+static bool replay (void);
+static void write_super (void);
+static struct jbuf *find_buf (struct txn *, disk_sector_t);
+static void clear_txn (struct txn *);
+static uint64_t jbuf_hash (const struct hash_elem *, void *);
+static bool jbuf_less (const struct hash_elem *, const struct hash_elem *,
+		void *);
+
+/* Initializes the journal module.  Until journal_open() succeeds,
+ * writes go straight to disk. */
+void
+journal_init (void) {
+	int i;
+
+	ASSERT (sizeof (struct journal_super) == DISK_SECTOR_SIZE);
+	ASSERT (sizeof (struct journal_desc) == DISK_SECTOR_SIZE);
+	ASSERT (sizeof (struct journal_commit) == DISK_SECTOR_SIZE);
+
+	for (i = 0; i < 2; i++) {
+		hash_init (&txns[i].bufs, jbuf_hash, jbuf_less, NULL);
+		list_init (&txns[i].order);
+		txns[i].cnt = 0;
+	}
+	running = &txns[0];
+	running->id = 0;
+	committing = NULL;
+	handle_cnt = 0;
+	lock_init (&journal_lock);
+	cond_init (&handles_done);
+	lock_init (&commit_lock);
+}
+
+/* Writes an empty journal to disk, while formatting. */
+void
+journal_create (void) {
+	static uint8_t zeros[DISK_SECTOR_SIZE];
+
+	ASSERT (!enabled);
+	seq = 1;
+	write_super ();
+	disk_write (filesys_disk, JOURNAL_SECTOR + 1, zeros);
+}
+
+/* Replays the journal if the file system was not shut down cleanly
+ * and starts logging metadata writes.  Returns false if the disk
+ * has no journal. */
+bool
+journal_open (void) {
+	struct journal_super *super = malloc (sizeof *super);
+
+	if (super == NULL)
+		PANIC ("[DBG] journal_open(): malloc for super failed");
+	disk_read (filesys_disk, JOURNAL_SECTOR, super);
+	if (super->magic != JOURNAL_MAGIC) {
+		free (super);
+		return false;
+	}
+	seq = super->seq;
+	free (super);
+
+	if (replay ()) {
+		seq++;
+		write_super ();
+	}
+	enabled = true;
+	thread_create ("journald", PRI_DEFAULT, journald, NULL);
+	return true;
+}
+
+/* Commits everything still in memory and stops logging.  With the
+ * -jcrash option the last transaction is left in the journal
+ * without being checkpointed, as if the machine lost power right
+ * after writing its commit record. */
+void
+journal_close (void) {
+	if (!enabled)
+		return;
+	commit (!journal_crash);
+	if (journal_crash)
+		printf ("Journal: crashed before checkpoint.\n");
+	enabled = false;
+}
+
+/* Starts a file system operation.  The sectors it writes until the
+ * matching journal_end() are committed together.  Calls may nest.
+ * If the running transaction is already large, commits it first. */
+void
+journal_begin (void) {
+	begin (true);
+}
+
+/* Like journal_begin(), but never waits for a commit.  For writes
+ * that other operations may be waiting for, such as writing back a
+ * page that is being evicted. */
+void
+journal_begin_nowait (void) {
+	begin (false);
+}
+
+/* Ends the operation started by journal_begin(). */
+void
+journal_end (void) {
+	struct thread *t = thread_current ();
+
+	ASSERT (t->journal_depth > 0);
+	// 이 연산이 바꾼 free map도 같은 transaction에 넣음
+	if (t->journal_depth == 1 && enabled)
+		free_map_flush ();
+	if (--t->journal_depth == 0) {
+		lock_acquire (&journal_lock);
+		if (--handle_cnt == 0)
+			cond_broadcast (&handles_done, &journal_lock);
+		lock_release (&journal_lock);
+	}
+}
+
+/* Commits the running transaction and writes it to its home
+ * locations, so that the sectors it released can be allocated
+ * again.  Returns false without committing inside an operation,
+ * which the commit would wait for, or while holding a lock. */
+bool
+journal_commit (void) {
+	if (!enabled || thread_current ()->journal_depth > 0 || !may_wait ())
+		return false;
+	commit (true);
+	return true;
+}
+
+/* Returns the id of the running transaction.  Sectors released by
+ * it may be reused once it is committed, see free_map_committed(). */
+uint32_t
+journal_current (void) {
+	uint32_t id;
+
+	lock_acquire (&journal_lock);
+	id = running->id;
+	lock_release (&journal_lock);
+	return id;
+}
+
+/* Returns true if metadata writes go through the journal. */
+bool
+journal_enabled (void) {
+	return enabled;
+}
+
+/* Reads SECTOR into BUFFER, seeing writes that have not reached
+ * their home location yet. */
+void
+journal_read (disk_sector_t sector, void *buffer) {
+	struct jbuf *b = NULL;
+
+	if (enabled) {
+		lock_acquire (&journal_lock);
+		b = find_buf (running, sector);
+		if (b == NULL && committing != NULL)
+			b = find_buf (committing, sector);
+		if (b != NULL)
+			memcpy (buffer, b->data, DISK_SECTOR_SIZE);
+		lock_release (&journal_lock);
+	}
+	if (b == NULL)
+		disk_read (filesys_disk, sector, buffer);
+}
+
+/* Writes BUFFER to SECTOR as part of the running transaction. */
+void
+journal_write (disk_sector_t sector, const void *buffer) {
+	struct jbuf *b;
+
+	if (!enabled) {
+		disk_write (filesys_disk, sector, buffer);
+		return;
+	}
+
+	lock_acquire (&journal_lock);
+	b = find_buf (running, sector);
+	if (b == NULL) {
+		b = malloc (sizeof *b);
+		if (b == NULL)
+			PANIC ("[DBG] journal_write(): malloc for jbuf failed");
+		b->sector = sector;
+		hash_insert (&running->bufs, &b->elem);
+		list_push_back (&running->order, &b->list_elem);
+		if (running->cnt++ == 0)
+			running->start = timer_ticks ();
+	}
+	memcpy (b->data, buffer, DISK_SECTOR_SIZE);
+	lock_release (&journal_lock);
+}
+
+// 가장 바깥의 journal_begin()이라면 연산 수를 올림
+// WAIT라면 그 전에 running transaction을 commit해 journal 영역을 넘지 않게 함
+static void
+begin (bool wait) {
+	struct thread *t = thread_current ();
+
+	if (t->journal_depth++ > 0)
+		return;
+	lock_acquire (&journal_lock);
+	while (wait && enabled && !has_room () && may_wait ()) {
+		lock_release (&journal_lock);
+		commit (true);
+		lock_acquire (&journal_lock);
+	}
+	handle_cnt++;
+	lock_release (&journal_lock);
+}
+
+// 진행중인 연산들과 새 연산 하나가 각각 JOURNAL_OP_MAX개를 더 기록해도
+// running transaction이 journal에 들어가고 아직 JOURNAL_HIGH개에 못 미치는지
+// journal_lock을 잡고 호출해야 함
+static bool
+has_room (void) {
+	return running->cnt < JOURNAL_HIGH
+		&& running->cnt + (handle_cnt + 1) * JOURNAL_OP_MAX <= JOURNAL_ROOM;
+}
+
+// lock을 잡은 채로 commit을 기다리면 그 lock을 기다리는 연산 때문에 commit이
+// 끝나지 않을 수 있으므로, 시스템 콜이 잡는 file_lock 말고는 lock이 없을 때만 기다림
+static bool
+may_wait (void) {
+	struct list *locks = &thread_current ()->lock_list;
+	struct list_elem *e;
+
+	for (e = list_begin (locks); e != list_end (locks); e = list_next (e))
+		if (list_entry (e, struct lock, elem) != &file_lock)
+			return false;
+	return true;
+}
+
+// running transaction이 충분히 커지거나 오래되면 commit하는 쓰레드
+static void
+journald (void *aux UNUSED) {
+	for (;;) {
+		bool due;
+
+		timer_sleep (JOURNAL_POLL_TICKS);
+		if (!enabled)
+			continue;
+		lock_acquire (&journal_lock);
+		due = running->cnt >= JOURNAL_HIGH
+			|| (running->cnt > 0
+					&& timer_elapsed (running->start) >= JOURNAL_COMMIT_TICKS);
+		lock_release (&journal_lock);
+		if (due)
+			commit (true);
+	}
+}
+
+// 진행중인 연산이 없을 때의 running transaction을 journal에 기록하고
+// CHECKPOINT라면 원래 위치에도 기록함
+static void
+commit (bool checkpoint) {
+	struct txn *t;
+
+	lock_acquire (&commit_lock);
+	lock_acquire (&journal_lock);
+	while (handle_cnt > 0)
+		cond_wait (&handles_done, &journal_lock);
+	t = committing = running;
+	running = t == &txns[0] ? &txns[1] : &txns[0];
+	running->id = t->id + 1;
+	lock_release (&journal_lock);
+
+	if (t->cnt > 0)
+		write_txn (t, checkpoint);
+
+	lock_acquire (&journal_lock);
+	committing = NULL;
+	lock_release (&journal_lock);
+	clear_txn (t);
+
+	// 이 transaction에서 반납된 sector는 이제 다시 할당할 수 있음
+	free_map_committed (t->id);
+	lock_release (&commit_lock);
+}
+
+// T의 sector들을 JOURNAL_TAGS개마다 descriptor를 붙여 journal에 기록하고
+// 마지막에 commit record를 하나 기록한 뒤에야 원래 위치에 기록함
+// 도중에 멈추면 commit record가 없으므로 transaction 전체가 버려짐
+static void
+write_txn (struct txn *t, bool checkpoint) {
+	struct journal_desc *desc = malloc (sizeof *desc);
+	struct journal_commit *rec = calloc (1, sizeof *rec);
+	disk_sector_t pos = JOURNAL_SECTOR + 1;
+	uint64_t checksum = 0;
+	struct list_elem *e;
+
+	if (desc == NULL || rec == NULL)
+		PANIC ("[DBG] write_txn(): malloc failed");
+	// begin()이 연산마다 JOURNAL_OP_MAX개의 자리를 남겨두므로 항상 들어감
+	ASSERT (t->cnt <= JOURNAL_ROOM);
+
+	// journal 영역에 순서대로 기록
+	e = list_begin (&t->order);
+	while (e != list_end (&t->order)) {
+		disk_sector_t desc_pos = pos++;
+
+		desc->cnt = 0;
+		for (; e != list_end (&t->order) && desc->cnt < JOURNAL_TAGS; e = list_next (e)) {
+			struct jbuf *b = list_entry (e, struct jbuf, list_elem);
+
+			desc->sectors[desc->cnt++] = b->sector;
+			disk_write (filesys_disk, pos++, b->data);
+			checksum = checksum * 31 + hash_bytes (b->data, DISK_SECTOR_SIZE);
+		}
+		desc->magic = DESC_MAGIC;
+		desc->seq = seq;
+		disk_write (filesys_disk, desc_pos, desc);
+	}
+	rec->magic = COMMIT_MAGIC;
+	rec->seq = seq;
+	rec->cnt = t->cnt;
+	rec->checksum = checksum;
+	disk_write (filesys_disk, pos, rec);
+
+	// -jcrash라면 commit record 직후에 멈춘 것처럼 함
+	if (checkpoint) {
+		// commit record까지 기록되었으므로 원래 위치에 기록
+		for (e = list_begin (&t->order); e != list_end (&t->order); e = list_next (e)) {
+			struct jbuf *b = list_entry (e, struct jbuf, list_elem);
+			disk_write (filesys_disk, b->sector, b->data);
+		}
+		seq++;
+		write_super ();
+	}
+	free (desc);
+	free (rec);
+}
+
+// superblock의 seq와 같은 온전한 transaction이 journal에 있으면 원래 위치에 기록
+// replay했다면 true 반환
+static bool
+replay (void) {
+	struct journal_desc *desc = malloc (sizeof *desc);
+	struct journal_commit *rec = malloc (sizeof *rec);
+	uint8_t *buf = malloc (DISK_SECTOR_SIZE);
+	const disk_sector_t end = JOURNAL_SECTOR + JOURNAL_SECTORS;
+	disk_sector_t pos = JOURNAL_SECTOR + 1;
+	uint64_t checksum = 0;
+	uint32_t cnt = 0, i;
+	bool valid = false;
+
+	if (desc == NULL || rec == NULL || buf == NULL)
+		PANIC ("[DBG] replay(): malloc failed");
+
+	// 같은 seq의 descriptor를 따라가며 checksum을 계산
+	// 가득 차지 않은 descriptor 또는 다른 sector가 나오면 그 자리가 commit record
+	for (;;) {
+		disk_read (filesys_disk, pos, desc);
+		if (desc->magic != DESC_MAGIC || desc->seq != seq
+				|| desc->cnt == 0 || desc->cnt > JOURNAL_TAGS
+				|| pos + 1 + desc->cnt >= end)
+			break;
+		for (i = 0; i < desc->cnt; i++) {
+			disk_read (filesys_disk, pos + 1 + i, buf);
+			checksum = checksum * 31 + hash_bytes (buf, DISK_SECTOR_SIZE);
+		}
+		cnt += desc->cnt;
+		pos += 1 + desc->cnt;
+		if (desc->cnt < JOURNAL_TAGS)
+			break;
+	}
+	// commit record가 없거나 맞지 않으면 기록 도중 멈춘 것이므로 버림
+	if (cnt > 0 && pos < end) {
+		disk_read (filesys_disk, pos, rec);
+		valid = rec->magic == COMMIT_MAGIC && rec->seq == seq
+			&& rec->cnt == cnt && rec->checksum == (uint32_t) checksum;
+	}
+
+	if (valid) {
+		uint32_t done = 0;
+
+		for (pos = JOURNAL_SECTOR + 1; done < cnt; pos += 1 + desc->cnt) {
+			disk_read (filesys_disk, pos, desc);
+			for (i = 0; i < desc->cnt; i++) {
+				disk_read (filesys_disk, pos + 1 + i, buf);
+				disk_write (filesys_disk, desc->sectors[i], buf);
+			}
+			done += desc->cnt;
+		}
+		printf ("Journal: replayed %u sectors.\n", (unsigned) cnt);
+	}
+	free (desc);
+	free (rec);
+	free (buf);
+	return valid;
+}
+
+// superblock에 다음 transaction의 seq를 기록
+static void
+write_super (void) {
+	struct journal_super *super = calloc (1, sizeof *super);
+
+	if (super == NULL)
+		PANIC ("[DBG] write_super(): malloc for super failed");
+	super->magic = JOURNAL_MAGIC;
+	super->seq = seq;
+	disk_write (filesys_disk, JOURNAL_SECTOR, super);
+	free (super);
+}
+
+// T에서 SECTOR의 buffer를 찾음, journal_lock을 잡은 상태로 호출
+static struct jbuf *
+find_buf (struct txn *t, disk_sector_t sector) {
+	struct jbuf key;
+	struct hash_elem *e;
+
+	key.sector = sector;
+	e = hash_find (&t->bufs, &key.elem);
+	return e != NULL ? hash_entry (e, struct jbuf, elem) : NULL;
+}
+
+// commit이 끝난 T의 buffer를 모두 해제
+static void
+clear_txn (struct txn *t) {
+	hash_clear (&t->bufs, NULL);
+	while (!list_empty (&t->order))
+		free (list_entry (list_pop_front (&t->order), struct jbuf, list_elem));
+	t->cnt = 0;
+}
+
+static uint64_t
+jbuf_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct jbuf *b = hash_entry (e, struct jbuf, elem);
+	return hash_bytes (&b->sector, sizeof b->sector);
+}
+
+static bool
+jbuf_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct jbuf, elem)->sector
+		< hash_entry (b, struct jbuf, elem)->sector;
+}
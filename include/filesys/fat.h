@@ -17,6 +17,7 @@ typedef uint32_t cluster_t;  /* Index of a cluster within FAT. */
 #define SECTORS_PER_CLUSTER 1 /* Number of sectors per cluster */
 #define FAT_BOOT_SECTOR 0     /* FAT boot sector. */
 #define ROOT_DIR_CLUSTER 1    /* Cluster for the root directory */
+#define JOURNAL_CLUSTER 2     /* First cluster of the journal (P3-EX) */
 
 void fat_init (void);
 void fat_open (void);
@@ -31,8 +32,14 @@ void fat_remove_chain (
     cluster_t clst, /* Cluster # to be removed */
     cluster_t pclst /* Previous cluster of clst, 0: clst is the start of chain */
 );
+cluster_t fat_create_chain_multiple (cluster_t clst, size_t cnt);
+size_t fat_extend_chain (cluster_t clst, size_t cnt);
 cluster_t fat_get (cluster_t clst);
 void fat_put (cluster_t clst, cluster_t val);
 disk_sector_t cluster_to_sector (cluster_t clst);
+cluster_t sector_to_cluster (disk_sector_t sector);
+void fat_flush (void);
+void fat_committed (uint32_t id);
+bool fat_pending (void);
 
 #endif /* filesys/fat.h */
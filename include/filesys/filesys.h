@@ -7,7 +7,13 @@
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
+#ifdef EFILESYS
+#include "filesys/fat.h"
+/* FAT에서는 ROOT_DIR_CLUSTER의 첫 sector가 root directory의 inode (P3-EX) */
+#define ROOT_DIR_SECTOR (cluster_to_sector (ROOT_DIR_CLUSTER))
+#else
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#endif
 
 /* Disk used for file system. */
 extern struct disk *filesys_disk;
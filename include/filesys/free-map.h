@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "devices/disk.h"
 
 void free_map_init (void);
@@ -12,6 +13,17 @@ void free_map_open (void);
 void free_map_close (void);
 
 bool free_map_allocate (size_t, disk_sector_t *);
+size_t free_map_allocate_at (disk_sector_t, size_t);
 void free_map_release (disk_sector_t, size_t);
+void free_map_flush (void);
+void free_map_committed (uint32_t id);
+bool free_map_pending (void);
+
+#ifndef EFILESYS
+bool free_map_needs_check (void);
+void free_map_rebuild_start (void);
+void free_map_mark (disk_sector_t, size_t);
+void free_map_rebuild_done (void);
+#endif
 
 #endif /* filesys/free-map.h */
@@ -0,0 +1,43 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/disk.h"
+
+// P3-EX
+/* Write-ahead metadata journal.  Inode, extent block, directory and
+ * free map sectors are written into the running transaction in
+ * memory instead of to disk.  A background thread commits many
+ * operations at once: the changed sectors are written to the
+ * journal area, followed by a commit record, and only then to their
+ * home locations.  A transaction found complete in the journal at
+ * mount is replayed. */
+#ifdef EFILESYS
+#include "filesys/fat.h"
+/* FAT에서는 fat_create()가 JOURNAL_CLUSTER부터 예약한 cluster들을 사용 */
+#define JOURNAL_SECTOR (cluster_to_sector (JOURNAL_CLUSTER))
+#else
+#define JOURNAL_SECTOR 2        /* First sector of the journal. */
+#endif
+#define JOURNAL_SECTORS 256     /* Number of sectors in the journal. */
+#define JOURNAL_OP_MAX 64       /* Most sectors one operation may log. */
+
+extern bool journal_crash; // 커널 옵션 -jcrash: 마지막 commit 후 checkpoint 없이 멈춤
+
+void journal_init (void);
+void journal_create (void);
+bool journal_open (void);
+void journal_close (void);
+
+void journal_begin (void);
+void journal_begin_nowait (void);
+void journal_end (void);
+bool journal_commit (void);
+uint32_t journal_current (void);
+bool journal_enabled (void);
+
+void journal_read (disk_sector_t, void *);
+void journal_write (disk_sector_t, const void *);
+
+#endif /* filesys/journal.h */
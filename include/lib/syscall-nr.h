@@ -36,6 +36,25 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_MSYNC,                  /* Write back a memory mapping. */
+	SYS_MADVISE,                /* Give advice about use of memory. */
+	SYS_SBRK,                   /* Change the program break. */
 };
 
+/* Pass as the fd of SYS_MMAP for zero-filled anonymous memory. */
+#define MAP_ANONYMOUS (-1)
+
+/* Flags for SYS_MSYNC. */
+#define MS_ASYNC 1              /* Schedule write-back and return. */
+#define MS_SYNC 2               /* Write back before returning. */
+
+/* Advice for SYS_MADVISE. */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random page references. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential page references. */
+#define MADV_WILLNEED 3         /* Will need these pages soon. */
+#define MADV_DONTNEED 4         /* Don't need these pages. */
+
 #endif /* lib/syscall-nr.h */
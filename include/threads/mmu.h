@@ -2,19 +2,39 @@
 #define THREAD_MMU_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "threads/pte.h"
 
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
+// P3-EX
+/* Gathers the user pages cleared from one pml4 so the TLB is
+ * invalidated once at tlb_gather_flush() instead of after every
+ * page.  Up to TLB_GATHER_MAX pages are invalidated one by one,
+ * beyond that the whole address space is flushed. */
+#define TLB_GATHER_MAX 32
+
+struct tlb_gather {
+	uint64_t *pml4;
+	size_t cnt; // va에 모아둔 주소 수
+	bool full; // TLB_GATHER_MAX를 넘어서 전체를 비워야 함
+	void *va[TLB_GATHER_MAX];
+};
+
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
 void pml4_destroy (uint64_t *pml4);
 void pml4_activate (uint64_t *pml4);
+void pcid_init (void); // P3-EX
 void *pml4_get_page (uint64_t *pml4, const void *upage);
 bool pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw);
 void pml4_clear_page (uint64_t *pml4, void *upage);
+void pml4_pte_clear_page (uint64_t *pml4, uint64_t *pte, void *upage); // P3
+void tlb_gather_init (struct tlb_gather *tlb, uint64_t *pml4); // P3-EX
+void tlb_gather_clear_page (struct tlb_gather *tlb, uint64_t *pte, void *upage);
+void tlb_gather_flush (struct tlb_gather *tlb);
 bool pml4_is_dirty (uint64_t *pml4, const void *upage);
 void pml4_set_dirty (uint64_t *pml4, const void *upage, bool dirty);
 void pml4_pte_set_dirty (uint64_t *pml4, uint64_t *pte, const void *vpage, bool dirty); // P3
@@ -0,0 +1,46 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+// P3-EX
+/* Object cache for fixed-size kernel objects.  Objects are carved
+ * out of whole pages (slabs) and handed out through a small
+ * magazine of free objects that is accessed with interrupts
+ * disabled instead of the cache lock. */
+#define SLAB_MAG_SIZE 32 // magazine에 담아두는 최대 free object 수
+
+struct slab_cache {
+	const char *name;
+	size_t obj_size; // 정렬된 object 크기
+	size_t obj_cnt; // slab 하나의 object 수
+	size_t obj_ofs; // slab 안의 첫 object 위치
+	void (*ctor) (void *); // slab을 만들 때 object마다 한 번 호출 (NULL 가능)
+
+	struct lock lock; // 아래의 slab 리스트 보호
+	struct list partial; // free object가 남아있는 slab
+	struct list full; // 모두 사용중인 slab
+	struct list_elem elem; // 모든 cache의 리스트
+
+	void *mag[SLAB_MAG_SIZE]; // 바로 할당할 수 있는 free object
+	size_t mag_cnt;
+
+	// 통계
+	size_t alloc_cnt; // 전체 할당 횟수
+	size_t hit_cnt; // magazine에서 바로 할당한 횟수
+	size_t in_use; // 사용중인 object 수
+	size_t slab_cnt; // cache가 사용중인 페이지 수
+};
+
+void slab_init (void);
+void slab_cache_init (struct slab_cache *, const char *name, size_t size,
+		void (*ctor) (void *));
+void *slab_alloc (struct slab_cache *) __attribute__ ((malloc));
+void slab_free (void *);
+bool slab_owns (const void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
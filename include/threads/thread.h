@@ -124,6 +124,9 @@ struct thread {
 	struct thread *donee_t; // 쓰레드가 acquire 대기중인 lock의 holder
 	// P1-AC
 	int64_t wake_tick; // 깨어날 시각
+	// P3-EX
+	void *malloc_cache; // threads/malloc.c의 쓰레드별 free block cache
+	int journal_depth; // filesys/journal.c의 중첩된 journal_begin() 수
 
 	/* Shared between thread.c and synch.c. */ // AND alarm clock (P1-AC)
 	struct list_elem elem;              /* List element. */
@@ -2,14 +2,20 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 struct page;
+struct supplemental_page_table;
 enum vm_type;
 
 struct anon_page {
     size_t swap_pg_no; // swap disk상의 페이지 번호
     bool is_stack; // 현재 anonymous 페이지가 stack에 속하는지 여부
+    bool in_swap; // swap_pg_no에 내용이 저장되어 있는지 여부
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void *do_sbrk (long increment);
+bool heap_alloc_page (struct supplemental_page_table *spt, void *va);
+bool heap_range_overlaps (struct supplemental_page_table *spt,
+						  void *addr, size_t length);
 
 #endif
@@ -0,0 +1,53 @@
+#ifndef VM_EVICT_H
+#define VM_EVICT_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct frame;
+struct page;
+
+/* Eviction policy interface (P3-EX).
+ * 물리 메모리에 올라간 프레임을 관리하고 evict할 프레임을 고름.
+ * 모든 callback은 frame_list_lock을 잡은 상태로 호출됨. */
+struct evict_policy {
+	const char *name; // 커널 옵션 -evict=NAME으로 선택할 때의 이름
+
+	// 정책의 자료구조 초기화, CAPACITY는 관리할 수 있는 최대 프레임 수
+	void (*init) (size_t capacity);
+	// 페이지가 채워진 프레임을 관리 대상에 추가 (fault 처리 직후)
+	void (*insert) (struct frame *frame);
+	// accessed bit 이외의 경로로 프레임이 사용되었음을 알림 (NULL 가능)
+	void (*touch) (struct frame *frame);
+	// evict할 프레임을 골라 관리 대상에서 제거 후 반환
+	struct frame *(*victim) (void);
+	// evict 없이 해제되는 프레임을 관리 대상에서 제거
+	void (*remove) (struct frame *frame);
+	// 관리중인 프레임이 없는지 여부
+	bool (*empty) (void);
+	// 삭제되는 페이지의 non-resident (ghost) 정보를 제거 (NULL 가능)
+	void (*forget) (struct page *page);
+};
+
+extern const struct evict_policy evict_fifo;
+extern const struct evict_policy evict_llru;
+extern const struct evict_policy evict_clock;
+extern const struct evict_policy evict_2q;
+extern const struct evict_policy evict_clockpro;
+extern const struct evict_policy evict_arc;
+
+extern const struct evict_policy *evict_policy; // 현재 사용중인 정책
+
+const struct evict_policy *evict_policy_find (const char *name);
+bool evict_policy_select (const char *name);
+void evict_policy_init (size_t capacity);
+void evict_policy_print_names (void);
+
+// 정책 구현에서 공유하는 accessed bit helper
+bool frame_collect_accessed (struct frame *frame);
+bool frame_test_and_clear_accessed (struct frame *frame);
+bool frame_referenced (struct frame *frame);
+void frame_mark_fresh (struct frame *frame);
+void frame_unmark_fresh (struct frame *frame);
+void frame_mark_accessed (struct frame *frame);
+
+#endif /* VM_EVICT_H */
@@ -6,6 +6,8 @@
 #include <list.h> // P3
 
 struct page;
+struct supplemental_page_table;
+struct mmap_elem;
 enum vm_type;
 
 struct file_page { // uninit의 aux에 저장되는 file_page_args를 그대로 받아옴
@@ -13,6 +15,10 @@ struct file_page { // uninit의 aux에 저장되는 file_page_args를 그대로
 	off_t ofs;
 	uint32_t page_read_bytes;
 	uint32_t page_zero_bytes;
+	// 마지막으로 파일과 동기화된 내용의 섹터별 hash (페이지의 섹터 수만큼)
+	// write-back 시 hash가 달라진 섹터만 다시 씀
+	// writable 매핑의 페이지만 따로 할당하며, NULL이면 페이지 전체를 씀
+	uint64_t *sector_hash;
 };
 
 void vm_file_init (void);
@@ -21,4 +27,12 @@ void file_backed_write_back(struct page *page, struct file *file); // P3
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+int do_msync (void *addr, size_t length, int flags);
+int do_madvise (void *addr, size_t length, int advice);
+void file_backed_readahead (struct page *page);
+bool mmap_alloc_page (struct supplemental_page_table *spt, void *va);
+struct mmap_elem *find_mmap_elem (struct supplemental_page_table *spt,
+								  void *va);
+bool mmap_range_overlaps (struct supplemental_page_table *spt,
+						  void *addr, size_t length);
 #endif
@@ -10,6 +10,8 @@
 #include "threads/mmu.h"
 #include "threads/init.h" // base_pml4 확인용
 
+#define STACK_LIM 0x47380000 // 47480000 + 1MB, heap도 이 아래에서만 늘어남
+
 enum vm_type {
 	/* page not initialized */
 	VM_UNINIT = 0,
@@ -45,6 +47,15 @@ enum vm_type {
 struct page_operations;
 struct thread;
 
+// 페이지의 disk I/O 진행 상태 (P3-EX)
+// I/O는 frame_list_lock 없이 수행되므로, 진행 중인 페이지에 접근하려는 쓰레드는
+// vm_page_wait_io()로 끝날 때까지 기다림
+enum page_io {
+	PAGE_IO_NONE = 0,
+	PAGE_IO_IN, // swap in (lazy load 포함) 중: frame은 연결됐지만 매핑 전
+	PAGE_IO_OUT, // swap out 중: 모든 pml4에서 제거됐지만 frame은 아직 연결됨
+};
+
 #define VM_TYPE(type) ((type) & 7)
 
 /* The representation of "page".
@@ -61,6 +72,13 @@ struct page {
 	// copy-on-write (P3-EX)
 	struct list share_list; // 페이지를 공유중인 spt의 리스트
 	int share_cnt;
+	// eviction policy의 non-resident (ghost) 정보 (P3-EX)
+	struct list_elem ghost_elem;
+	uint8_t ghost; // 0이면 ghost 아님, 이외 값의 의미는 정책별로 다름
+	uint8_t io_state; // enum page_io
+	uint8_t io_waiters; // vm_page_wait_io()로 기다리는 쓰레드 수 (ksmd가 해제하지 않도록)
+	// 여러 프로세스가 공유하는 실행 파일의 read-only 페이지라면 text table의 항목
+	struct text_page *text;
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -75,23 +93,33 @@ struct page {
 };
 
 // share시에는 같은 페이지가 여러 hash table에 삽입되므로, 개별 구조체를 만들어 삽입
+// spt에 한 번 삽입되면 va가 제거될 때까지 유지됨 (COW, 병합 시에는 page만 교체)
 struct page_elem {
 	struct page *page;
 	struct hash_elem elem;
+	struct mmap_elem *mmap; // mmap 영역의 페이지라면 속한 mmap_elem, 아니면 NULL
+	struct list_elem mmap_link; // mmap_elem.pages의 elem
 };
 
 
-struct list frame_list; // 물리 메모리에 할당된 frame의 리스트
-struct frame frame_nil; // sentinel용 (LRU, Clock일 때 사용)
+// 물리 메모리에 할당된 frame은 vm/evict.h의 eviction policy가 관리
 struct lock frame_list_lock;
-// lock: vm_handle_wp, vm_try_handle_fault, supplemental_page_table_kill에서 사용
+// lock: eviction policy, page <-> frame 연결, share_list, page의 io_state를 보호
+//       disk I/O 동안에는 잡지 않음 (page의 io_state로 대신 표시)
+// 이외의 자원은 각자의 lock으로 보호:
+//       빈 프레임 할당 - palloc, zero_pool_lock / swap table - anon.c swap_lock
+//       mmap_hash - supplemental_page_table.mmap_lock
 
 /* The representation of "frame" */
 struct frame {
 	void *kva;
 	struct page *page;
 	uint64_t *kpte; // pml4와 연결 (kernel pml4)
-	struct list_elem elem; // frame list에 넣기 위한 elem
+	struct list_elem elem; // eviction policy의 리스트에 넣기 위한 elem
+	uint8_t evict_state; // 정책별 프레임 상태 (hot/cold, T1/T2 등)
+	bool fresh; // 삽입 후 accessed bit을 아직 확인하지 않음
+	bool referenced; // aging pass가 미리 모아둔 accessed bit
+	uint64_t ksm_sum; // ksmd가 직전 scan에서 계산한 내용의 hash
 };
 
 /* The function table for page operations.
@@ -116,21 +144,53 @@ struct page_operations {
 struct supplemental_page_table {
 	struct hash hash;
 	struct hash mmap_hash;
+	// 같은 mmap_elem들을 addr 순으로 정렬한 리스트 (주소를 포함하는 영역 탐색용)
+	struct list mmap_list;
+	struct mmap_elem *mmap_hint; // 직전에 find_mmap_elem()이 찾은 영역
+	struct lock mmap_lock; // kswapd가 swap 중에 mmap_hash를 읽으므로 필요
 	uint64_t *pml4; // spt에 대응되는 pml4를 저장
+	// sbrk로 늘어나는 heap: [heap_start, brk)
+	void *heap_start; // 실행 파일의 마지막 segment 다음 페이지
+	void *brk;
+	// 여러 페이지를 제거하는 동안 pml4의 TLB 무효화를 모아둠 (NULL이면 바로 무효화)
+	struct tlb_gather *tlb;
 };
 
 // 페이지의 share_list에 spt의 주소를 저장할 구조체
+// pte는 처음 pml4에 매핑할 때 캐시해두고, pml4가 삭제될 때까지 유효함
+// (pml4_clear_page는 present bit만 지우고 page table은 유지)
 struct spt_elem {
 	struct supplemental_page_table *spt;
+	uint64_t *pte; // spt->pml4에서 page->va의 pte, 매핑된 적 없으면 NULL
 	struct list_elem elem;
 };
 
+// 같은 실행 파일을 실행하는 프로세스끼리 read-only segment 페이지를 공유하기 위한
+// 전역 text table의 항목: (inode, ofs, va, read_bytes)가 같으면 같은 내용
+struct text_page {
+	struct inode *inode; // 페이지가 등록되어 있는 동안 열어둠
+	off_t ofs;
+	void *va;
+	uint32_t read_bytes;
+	struct page *page;
+	struct hash_elem elem;
+	struct list_elem dead_elem; // text table에서 제거되어 inode를 닫을 때까지의 리스트
+};
+
 // mmap중인 file을 관리하기 위한 구조체: thread.mmap_hash 안에 저장됨
+// 페이지는 영역 안의 주소에 처음 접근할 때 만들어짐 (mmap_alloc_page)
 struct mmap_elem {
 	struct hash_elem elem;
+	struct list_elem list_elem; // supplemental_page_table.mmap_list의 elem
 	struct file *file;
 	void *addr;
 	int pg_cnt;
+	off_t ofs; // addr에 매핑된 파일의 위치
+	uint32_t read_bytes; // 파일에서 읽을 전체 byte 수, 나머지는 0으로 채움
+	bool writable;
+	struct list pages; // 이 영역에서 만들어진 페이지의 page_elem 리스트
+	int advice; // madvise로 받은 MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL
+	void *next_fault; // 직전 fault의 다음 페이지 (sequential 접근 감지용)
 };
 
 // uninit page의 aux에 저장되는 구조체
@@ -153,9 +213,15 @@ void supplemental_page_table_kill (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_range_has_page (struct supplemental_page_table *spt,
+		void *addr, size_t length);
+void spt_link_mmap_page (struct supplemental_page_table *spt, void *va,
+		struct mmap_elem *me);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
 void vm_init (void);
+void vm_print_stats (void);
+extern bool vm_ksm_enabled; // 커널 옵션 -ksm: 같은 내용의 anon 페이지 병합
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -171,5 +237,21 @@ enum vm_type page_get_type (struct page *page);
 bool vm_get_page_writable(struct page *page);
 bool vm_get_addr_writable(void *va);
 bool vm_get_addr_readable(void *va);
+bool vm_page_is_dirty(struct page *page);
+void vm_page_wait_io(struct page *page);
+void vm_page_io_done(struct page *page);
+void vm_page_clear_dirty(struct page *page);
+void vm_evict_page(void *va);
+struct uninit_page_args *vm_alloc_page_args(void);
+bool vm_alloc_anon_zero_page(void *upage, bool writable);
+bool vm_share_text_page(struct supplemental_page_table *spt, struct file *file,
+						off_t ofs, void *va, uint32_t read_bytes);
+void vm_register_text_page(struct page *page, struct file *file,
+						   off_t ofs, uint32_t read_bytes);
+void mmap_remove_pages(struct supplemental_page_table *spt,
+					   struct mmap_elem *me);
+bool spt_tlb_gather_begin(struct supplemental_page_table *spt,
+						  struct tlb_gather *tlb);
+void spt_tlb_gather_end(struct supplemental_page_table *spt, bool started);
 
 #endif  /* VM_VM_H */
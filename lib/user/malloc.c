@@ -0,0 +1,255 @@
+#include <malloc.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A size-class allocator for user programs.
+
+   Requests of up to MAX_SMALL bytes are rounded up to a power of
+   two of at least MIN_SMALL bytes.  Each size class keeps a free
+   list of blocks of exactly that size, so malloc() and free() of
+   small blocks are a list pop and push.  New blocks are carved
+   off the end of the current arena, which grows by ARENA_SIZE
+   bytes at a time with sbrk().
+
+   Larger requests get a block of their own, rounded up to
+   ALIGN bytes.  Freed large blocks go on a single first-fit list
+   and are reused whole.
+
+   Every block is preceded by a header that records its size
+   class and usable size.  Blocks and headers are ALIGN-byte
+   aligned.  User processes are single-threaded, so there is no
+   locking. */
+
+#define ALIGN 16                /* Block alignment. */
+#define MIN_SMALL 16            /* Smallest size class. */
+#define MAX_SMALL 2048          /* Largest size class. */
+#define CLASS_CNT 8             /* Number of size classes. */
+#define LARGE CLASS_CNT         /* Class of a large block. */
+#define ARENA_SIZE (16 * 1024)  /* sbrk() increment for new arena space. */
+#define MAGIC 0x9a548eed        /* Detects bad free() arguments. */
+
+/* Block header. */
+struct header
+  {
+    uint32_t magic;             /* MAGIC while allocated. */
+    uint32_t class;             /* Size class, or LARGE. */
+    size_t size;                /* Usable bytes after the header. */
+  };
+
+/* A free block reuses its payload as a list link. */
+struct free_block
+  {
+    struct free_block *next;
+  };
+
+static struct free_block *free_lists[CLASS_CNT];
+static struct free_block *large_list;
+static uint8_t *arena_cur;      /* Next unused byte of the arena. */
+static uint8_t *arena_end;      /* End of the arena (the program break). */
+
+static struct header *carve (size_t size);
+static void *block_payload (struct header *);
+static struct header *payload_block (void *);
+
+/* Returns the size class for a SIZE-byte request,
+   or LARGE if it is bigger than MAX_SMALL. */
+static unsigned
+size_class (size_t size)
+{
+  unsigned class = 0;
+  size_t class_size = MIN_SMALL;
+
+  if (size > MAX_SMALL)
+    return LARGE;
+  while (class_size < size)
+    {
+      class_size *= 2;
+      class++;
+    }
+  return class;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  struct header *h;
+  unsigned class;
+
+  if (size == 0)
+    return NULL;
+
+  class = size_class (size);
+  if (class != LARGE)
+    {
+      struct free_block **list = &free_lists[class];
+      if (*list != NULL)
+        {
+          /* Reuse a freed block of the same class. */
+          struct free_block *b = *list;
+          *list = b->next;
+          h = payload_block (b);
+        }
+      else
+        {
+          h = carve ((size_t) MIN_SMALL << class);
+          if (h == NULL)
+            return NULL;
+        }
+    }
+  else
+    {
+      /* First fit among the freed large blocks. */
+      struct free_block **bp;
+
+      size = ROUND_UP (size, ALIGN);
+      for (bp = &large_list; *bp != NULL; bp = &(*bp)->next)
+        if (payload_block (*bp)->size >= size)
+          break;
+      if (*bp != NULL)
+        {
+          h = payload_block (*bp);
+          *bp = (*bp)->next;
+        }
+      else
+        {
+          h = carve (size);
+          if (h == NULL)
+            return NULL;
+        }
+    }
+
+  h->magic = MAGIC;
+  h->class = class;
+  return block_payload (h);
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  size = a * b;
+  if (size < a || size < b)
+    return NULL;
+
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+  return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.  If successful, returns the new
+   block; on failure, returns a null pointer.  A call with null
+   OLD_BLOCK is equivalent to malloc(NEW_SIZE).  A call with zero
+   NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  else if (old_block == NULL)
+    return malloc (new_size);
+  else
+    {
+      struct header *h = payload_block (old_block);
+      void *new_block;
+
+      /* The block already has room. */
+      if (new_size <= h->size)
+        return old_block;
+
+      new_block = malloc (new_size);
+      if (new_block != NULL)
+        {
+          memcpy (new_block, old_block, h->size);
+          free (old_block);
+        }
+      return new_block;
+    }
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  struct header *h;
+  struct free_block *b = p;
+
+  if (p == NULL)
+    return;
+
+  h = payload_block (p);
+  ASSERT (h->magic == MAGIC);
+  h->magic = 0;
+
+  if (h->class != LARGE)
+    {
+      b->next = free_lists[h->class];
+      free_lists[h->class] = b;
+    }
+  else
+    {
+      b->next = large_list;
+      large_list = b;
+    }
+}
+
+/* Carves a block with SIZE usable bytes off the arena, growing
+   the arena with sbrk() if needed.  Returns a null pointer if
+   the program break cannot be moved. */
+static struct header *
+carve (size_t size)
+{
+  size_t need = sizeof (struct header) + size;
+  struct header *h;
+
+  if (arena_cur == NULL || (size_t) (arena_end - arena_cur) < need)
+    {
+      size_t grow = ROUND_UP (need, ARENA_SIZE);
+      uint8_t *brk = sbrk (grow);
+
+      if (brk == (uint8_t *) -1)
+        return NULL;
+      if (brk != arena_end)
+        {
+          /* Someone else moved the break: the rest of the old
+             arena is lost, start a new one. */
+          arena_cur = (uint8_t *) ROUND_UP ((uintptr_t) brk, ALIGN);
+        }
+      arena_end = brk + grow;
+      if ((size_t) (arena_end - arena_cur) < need)
+        return NULL;
+    }
+
+  h = (struct header *) arena_cur;
+  h->size = size;
+  arena_cur += need;
+  return h;
+}
+
+/* Returns the payload of block H. */
+static void *
+block_payload (struct header *h)
+{
+  return h + 1;
+}
+
+/* Returns the header of the block whose payload is P. */
+static struct header *
+payload_block (void *p)
+{
+  return (struct header *) p - 1;
+}
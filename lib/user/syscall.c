@@ -155,6 +155,21 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+msync (void *addr, size_t length, int flags) {
+	return syscall3 (SYS_MSYNC, addr, length, flags);
+}
+
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+void *
+sbrk (long increment) {
+	return (void *) syscall1 (SYS_SBRK, increment);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+fail "journal was not replayed at mount\n"
+  if !grep (/^Journal: replayed \d+ sectors/, read_text_file ("$test.output"));
+my ($fs);
+$fs->{"file$_"} = [random_bytes (512)] foreach 0...19;
+check_archive ($fs);
+pass;
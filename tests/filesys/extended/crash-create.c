@@ -0,0 +1,8 @@
+/* Creates 20 files in the root directory.  The kernel runs with
+   -jcrash, so at shutdown it stops right after writing the commit
+   record of the last journal transaction, before any of it reaches
+   its home location.  The persistence check then needs the journal
+   to be replayed at mount to find the files. */
+
+#define FILE_CNT 20
+#include "tests/filesys/extended/grow-dir.inc"
@@ -0,0 +1,32 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(crash-create) begin
+(crash-create) creating and checking "file0"
+(crash-create) creating and checking "file1"
+(crash-create) creating and checking "file2"
+(crash-create) creating and checking "file3"
+(crash-create) creating and checking "file4"
+(crash-create) creating and checking "file5"
+(crash-create) creating and checking "file6"
+(crash-create) creating and checking "file7"
+(crash-create) creating and checking "file8"
+(crash-create) creating and checking "file9"
+(crash-create) creating and checking "file10"
+(crash-create) creating and checking "file11"
+(crash-create) creating and checking "file12"
+(crash-create) creating and checking "file13"
+(crash-create) creating and checking "file14"
+(crash-create) creating and checking "file15"
+(crash-create) creating and checking "file16"
+(crash-create) creating and checking "file17"
+(crash-create) creating and checking "file18"
+(crash-create) creating and checking "file19"
+(crash-create) end
+EOF
+fail "journal was not left unchecked at shutdown\n"
+  if !grep (/^Journal: crashed before checkpoint/, read_text_file ("$test.output"));
+pass;
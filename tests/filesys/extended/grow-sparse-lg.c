@@ -0,0 +1,64 @@
+/* Creates a file that is larger than the file system disk and
+   writes a few bytes far apart in it.  This only works if the
+   file's sectors are allocated when they are first written, with
+   the regions that were never written reading back as zeros. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (32 * 1024 * 1024)
+
+static const int offsets[] = {0, 1234567, 9999999, 20000000, FILE_SIZE - 1};
+#define OFFSET_CNT ((int) (sizeof offsets / sizeof *offsets))
+
+static char buf[1024];
+
+void
+test_main (void) 
+{
+  const char *file_name = "testfile";
+  int fd;
+  int i;
+
+  CHECK (create (file_name, FILE_SIZE), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"%s\"", file_name);
+
+  msg ("write \"%s\"", file_name);
+  for (i = 0; i < OFFSET_CNT; i++)
+    {
+      char c = 'a' + i;
+
+      seek (fd, offsets[i]);
+      if (write (fd, &c, 1) != 1)
+        fail ("write at offset %d failed", offsets[i]);
+    }
+
+  msg ("verify \"%s\"", file_name);
+  for (i = 0; i < OFFSET_CNT; i++)
+    {
+      int start = offsets[i] - (int) sizeof buf / 2;
+      int size = sizeof buf;
+      int j;
+
+      if (start < 0)
+        start = 0;
+      if (start + size > FILE_SIZE)
+        size = FILE_SIZE - start;
+      seek (fd, start);
+      if (read (fd, buf, size) != size)
+        fail ("read at offset %d failed", start);
+      for (j = 0; j < size; j++)
+        {
+          char expected = start + j == offsets[i] ? 'a' + i : 0;
+          if (buf[j] != expected)
+            fail ("byte %d is %d, expected %d",
+                  start + j, buf[j], expected);
+        }
+    }
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
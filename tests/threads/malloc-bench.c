@@ -0,0 +1,159 @@
+/* Exercises malloc() and free() from several threads at once.
+
+   Each thread keeps a small table of live blocks and randomly
+   frees one or allocates a new one of a random size, mostly from
+   the small size classes and sometimes above the largest class.
+   Every block is filled with a pattern that is checked when it
+   is freed, so blocks handed out twice or corrupted through a
+   thread cache are caught.  Then a buffer is grown step by step
+   with realloc() to check that its contents survive and that
+   some resizes happen in place. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 4
+#define OP_CNT 20000            /* Operations per thread. */
+#define SLOT_CNT 64             /* Live blocks per thread. */
+#define REALLOC_CNT 64          /* Growth steps in the realloc phase. */
+
+struct bench_thread
+  {
+    struct semaphore *done;
+    unsigned seed;
+    int id;
+    int ok;
+  };
+
+/* Returns a pseudo-random number from *SEED. */
+static unsigned
+next_rand (unsigned *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Fill byte of block SLOT owned by thread ID. */
+static uint8_t
+fill_byte (int id, int slot)
+{
+  return (id * SLOT_CNT + slot) & 0xff;
+}
+
+static void
+bench_thread (void *aux)
+{
+  struct bench_thread *t = aux;
+  uint8_t *blocks[SLOT_CNT];
+  size_t sizes[SLOT_CNT];
+  int i;
+
+  memset (blocks, 0, sizeof blocks);
+  t->ok = 1;
+  for (i = 0; i < OP_CNT; i++)
+    {
+      int slot = next_rand (&t->seed) % SLOT_CNT;
+
+      if (blocks[slot] != NULL)
+        {
+          size_t j;
+
+          for (j = 0; j < sizes[slot]; j++)
+            if (blocks[slot][j] != fill_byte (t->id, slot))
+              t->ok = 0;
+          free (blocks[slot]);
+          blocks[slot] = NULL;
+        }
+      else
+        {
+          unsigned r = next_rand (&t->seed);
+
+          if (r % 16 == 0)
+            sizes[slot] = 2000 + r % 4000;
+          else
+            sizes[slot] = 16 + r % 1008;
+          blocks[slot] = malloc (sizes[slot]);
+          if (blocks[slot] == NULL)
+            {
+              t->ok = 0;
+              continue;
+            }
+          memset (blocks[slot], fill_byte (t->id, slot), sizes[slot]);
+        }
+    }
+
+  for (i = 0; i < SLOT_CNT; i++)
+    free (blocks[i]);
+  sema_up (t->done);
+}
+
+/* Grows a buffer with realloc() and returns how many of the
+   resizes kept the same address. */
+static int
+realloc_phase (void)
+{
+  uint8_t *buf = NULL;
+  size_t size = 0;
+  int in_place = 0;
+  int i;
+
+  for (i = 1; i <= REALLOC_CNT; i++)
+    {
+      size_t new_size = i * 200;
+      uint8_t *p = realloc (buf, new_size);
+      size_t j;
+
+      if (p == NULL)
+        fail ("realloc to %zu bytes failed", new_size);
+      for (j = 0; j < size; j++)
+        if (p[j] != (uint8_t) j)
+          fail ("realloc to %zu bytes lost byte %zu", new_size, j);
+      if (p == buf)
+        in_place++;
+      for (j = size; j < new_size; j++)
+        p[j] = j;
+      buf = p;
+      size = new_size;
+    }
+  free (buf);
+  return in_place;
+}
+
+void
+test_malloc_bench (void)
+{
+  struct bench_thread threads[THREAD_CNT];
+  struct semaphore done;
+  int64_t start;
+  int i;
+
+  sema_init (&done, 0);
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+
+      threads[i].done = &done;
+      threads[i].seed = i + 1;
+      threads[i].id = i;
+      snprintf (name, sizeof name, "bench %d", i);
+      thread_create (name, PRI_DEFAULT, bench_thread, &threads[i]);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (!threads[i].ok)
+      fail ("thread %d found a corrupted block", i);
+  msg ("%d threads x %d ops: %lld ticks",
+       THREAD_CNT, OP_CNT, timer_elapsed (start));
+
+  msg ("realloc: %d of %d resizes in place",
+       realloc_phase (), REALLOC_CNT);
+  pass ();
+}
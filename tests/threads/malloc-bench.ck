@@ -0,0 +1,26 @@
+# -*- perl -*-
+
+# The timing varies from run to run, so we only check that every
+# thread finished without finding a corrupted block and that some
+# of the realloc() resizes were done in place.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+fail "Missing benchmark result.\n"
+  if !grep (/\(malloc-bench\) \d+ threads x \d+ ops: \d+ ticks/, @output);
+
+my ($in_place);
+foreach (@output) {
+    $in_place = $1 if /\(malloc-bench\) realloc: (\d+) of \d+ resizes in place/;
+}
+fail "Missing realloc result.\n" if !defined $in_place;
+fail "No realloc() resize was done in place.\n" if $in_place == 0;
+
+pass;
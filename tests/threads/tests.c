@@ -38,6 +38,10 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"malloc-bench", test_malloc_bench},
+#ifdef VM
+    {"evict-bench", test_evict_bench},
+#endif
   };
 
 static const char *test_name;
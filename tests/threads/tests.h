@@ -32,6 +32,10 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_malloc_bench;
+#ifdef VM
+extern test_func test_evict_bench;
+#endif
 
 void msg (const char *, ...);
 void fail (const char *, ...);
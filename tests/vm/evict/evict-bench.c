@@ -0,0 +1,138 @@
+/* Trace-driven comparison of the eviction policies.
+
+   Replays a synthetic reference trace against each policy with a
+   fixed number of fake frames and reports the fault rate.  Every
+   round touches a small hot working set several times and then
+   streams through a burst of pages that are never used again, so
+   a policy that lets the scan flush the hot set pays for the hot
+   set again on every round.  Accessed bits are emulated through
+   the frames' kernel PTE pointers, the same way the hardware sets
+   them for real frames. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "vm/vm.h"
+#include "vm/evict.h"
+
+#define FRAME_CNT 64            /* Frames available to the policy. */
+#define HOT_CNT 40              /* Pages in the hot working set. */
+#define HOT_PASSES 4            /* Passes over the hot set per round. */
+#define SCAN_CNT 100            /* Pages streamed once per round. */
+#define ROUND_CNT 16
+#define PAGE_CNT (HOT_CNT + SCAN_CNT * ROUND_CNT)
+
+static struct page *pages;
+static struct frame frames[FRAME_CNT];
+static uint64_t ptes[FRAME_CNT];
+static size_t used_cnt;
+static int fault_cnt;
+static int access_cnt;
+
+/* References PAGE, faulting it in through POLICY if needed. */
+static void
+touch_page (const struct evict_policy *policy, struct page *page)
+{
+  struct frame *frame;
+
+  access_cnt++;
+  if (page->frame != NULL)
+    {
+      *page->frame->kpte |= PTE_A;
+      return;
+    }
+
+  fault_cnt++;
+  if (used_cnt < FRAME_CNT)
+    {
+      frame = &frames[used_cnt];
+      frame->kpte = &ptes[used_cnt];
+      used_cnt++;
+    }
+  else
+    {
+      frame = policy->victim ();
+      frame->page->frame = NULL;
+    }
+
+  frame->page = page;
+  page->frame = frame;
+  *frame->kpte = 0;
+  policy->insert (frame);
+
+  /* The faulting access itself. */
+  *frame->kpte |= PTE_A;
+}
+
+/* Replays the trace against POLICY and returns the fault count. */
+static int
+run_trace (const struct evict_policy *policy)
+{
+  int round, pass, i;
+
+  evict_policy = policy;
+  evict_policy_init (FRAME_CNT);
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i].va = (void *) ((uint64_t) i * PGSIZE);
+      pages[i].frame = NULL;
+      list_init (&pages[i].share_list);
+      pages[i].share_cnt = 0;
+      pages[i].ghost = 0;
+    }
+  used_cnt = 0;
+  fault_cnt = access_cnt = 0;
+
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      for (pass = 0; pass < HOT_PASSES; pass++)
+        for (i = 0; i < HOT_CNT; i++)
+          touch_page (policy, &pages[(i * 7 + pass * 3) % HOT_CNT]);
+      for (i = 0; i < SCAN_CNT; i++)
+        touch_page (policy, &pages[HOT_CNT + round * SCAN_CNT + i]);
+    }
+
+  return fault_cnt;
+}
+
+void
+test_evict_bench (void)
+{
+  static const char *names[] =
+    {"fifo", "llru", "clock", "2q", "clockpro", "arc"};
+  const struct evict_policy *saved = evict_policy;
+  size_t i;
+
+  lock_acquire (&frame_list_lock);
+  if (!evict_policy->empty ())
+    {
+      lock_release (&frame_list_lock);
+      fail ("user frames are in use");
+    }
+
+  pages = calloc (PAGE_CNT, sizeof *pages);
+  if (pages == NULL)
+    fail ("out of memory");
+
+  for (i = 0; i < sizeof names / sizeof *names; i++)
+    {
+      const struct evict_policy *policy = evict_policy_find (names[i]);
+      int faults;
+
+      ASSERT (policy != NULL);
+      faults = run_trace (policy);
+      msg ("%s: %d faults / %d accesses (%d.%d%%)", policy->name,
+           faults, access_cnt, faults * 100 / access_cnt,
+           faults * 1000 / access_cnt % 10);
+    }
+
+  /* Give the real policy back its (empty) state. */
+  evict_policy = saved;
+  evict_policy_init (palloc_page_cnt (PAL_USER));
+  lock_release (&frame_list_lock);
+
+  free (pages);
+}
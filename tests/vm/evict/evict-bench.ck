@@ -0,0 +1,34 @@
+# -*- perl -*-
+
+# Fault counts depend only on the policies, not on timing, but we
+# check relations rather than exact numbers: the scan-resistant
+# policies must keep the hot set across the scan bursts and so take
+# fewer faults than the plain FIFO and clock policies.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my (%faults);
+foreach (@output) {
+    $faults{$1} = $2 if /\(evict-bench\) (\S+): (\d+) faults/;
+}
+
+foreach my $policy (qw (fifo llru clock 2q clockpro arc)) {
+    fail "No result for policy $policy.\n" if !defined $faults{$policy};
+}
+
+foreach my $policy (qw (clockpro arc)) {
+    foreach my $base (qw (fifo clock)) {
+	fail "$policy ($faults{$policy} faults) is not better than "
+	  . "$base ($faults{$base} faults).\n"
+	  if $faults{$policy} >= $faults{$base};
+    }
+}
+
+pass;
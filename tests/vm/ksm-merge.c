@@ -0,0 +1,79 @@
+/* Forks a child that rewrites every page of an inherited buffer
+   with the same contents, giving the kernel's same-page merging a
+   chance to merge the private copies back into the parent's pages.
+   Then checks that writes on either side stay private. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 32
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+static void
+fill (char value_base)
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    memset (buf + i * PAGE_SIZE, value_base + i, PAGE_SIZE);
+}
+
+static void
+verify (const char *who, char value_base, char changed)
+{
+  size_t i, j;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      char expected = i % 2 ? changed + i : value_base + i;
+      for (j = 0; j < PAGE_SIZE; j += 512)
+        if (buf[i * PAGE_SIZE + j] != expected)
+          fail ("%s: byte %zu of page %zu is %02hhx (should be %02hhx)",
+                who, j, i, buf[i * PAGE_SIZE + j], expected);
+    }
+}
+
+/* Reads the buffer many times so the kernel threads get to run. */
+static void
+spin (void)
+{
+  volatile unsigned sum = 0;
+  int round;
+  size_t i;
+
+  for (round = 0; round < 5000; round++)
+    for (i = 0; i < sizeof buf; i += 64)
+      sum += buf[i];
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  size_t i;
+
+  fill ('a');
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      /* Private copies with the same contents as the parent. */
+      fill ('a');
+      spin ();
+
+      for (i = 1; i < PAGE_CNT; i += 2)
+        memset (buf + i * PAGE_SIZE, 'A' + i, PAGE_SIZE);
+      verify ("child", 'a', 'A');
+      exit (0);
+    }
+
+  CHECK (wait (child) == 0, "wait for child");
+  for (i = 1; i < PAGE_CNT; i += 2)
+    memset (buf + i * PAGE_SIZE, 'a' + i, PAGE_SIZE);
+  verify ("parent", 'a', 'a');
+  msg ("parent pages intact");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(ksm-merge) wait for child
+(ksm-merge) parent pages intact
+(ksm-merge) end
+EOF
+fail "no pages were merged\n"
+  if !grep (/^KSM: merged [1-9]\d* pages/, read_text_file ("$test.output"));
+pass;
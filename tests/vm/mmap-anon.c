@@ -0,0 +1,42 @@
+/* Maps anonymous memory, checks that it starts out zeroed,
+   writes to it and unmaps it. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define SIZE (16 * 4096)
+
+void
+test_main (void)
+{
+  void *map;
+  size_t i;
+
+  CHECK ((map = mmap (ACTUAL, SIZE, 1, MAP_ANONYMOUS, 0)) != MAP_FAILED,
+         "mmap anonymous");
+  for (i = 0; i < SIZE; i++)
+    if (ACTUAL[i] != 0)
+      fail ("byte %zu of anonymous mapping is %02hhx (should be 0)",
+            i, ACTUAL[i]);
+
+  for (i = 0; i < SIZE; i += 4096)
+    ACTUAL[i] = i / 4096 + 1;
+  for (i = 0; i < SIZE; i += 4096)
+    if (ACTUAL[i] != (char) (i / 4096 + 1))
+      fail ("page %zu of anonymous mapping lost its data", i / 4096);
+  msg ("write anonymous mapping");
+
+  CHECK (mmap (ACTUAL + 4096, 4096, 1, MAP_ANONYMOUS, 0) == MAP_FAILED,
+         "overlapping anonymous mmap must fail");
+  CHECK (mmap (ACTUAL + SIZE, 4096, 1, MAP_ANONYMOUS, 4096) == MAP_FAILED,
+         "anonymous mmap with offset must fail");
+
+  munmap (map);
+  CHECK (mmap (ACTUAL, 4096, 0, MAP_ANONYMOUS, 0) != MAP_FAILED,
+         "mmap anonymous again");
+  if (ACTUAL[0] != 0)
+    fail ("remapped anonymous memory is not zeroed");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap anonymous
+(mmap-anon) write anonymous mapping
+(mmap-anon) overlapping anonymous mmap must fail
+(mmap-anon) anonymous mmap with offset must fail
+(mmap-anon) mmap anonymous again
+(mmap-anon) end
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Scans a large mapped file after hinting the access pattern
+   with madvise, drops the pages and checks that the data is
+   still correct when they are faulted back in. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+void
+test_main (void)
+{
+  int handle;
+  char *actual = (char *) 0x10000000;
+  void *map;
+  size_t len = strlen (large);
+  size_t map_len = (len + 4095) / 4096 * 4096;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK ((map = mmap (actual, sizeof (large), 0, handle, 0)) != MAP_FAILED,
+         "mmap \"large.txt\"");
+
+  CHECK (madvise (map, map_len, MADV_SEQUENTIAL) == 0, "madvise sequential");
+  if (memcmp (actual, large, len))
+    fail ("sequential read of mmap'd file reported bad data");
+
+  CHECK (madvise (map, map_len, MADV_DONTNEED) == 0, "madvise dontneed");
+  CHECK (madvise (map, 16 * 4096, MADV_WILLNEED) == 0, "madvise willneed");
+  CHECK (madvise (map, map_len, MADV_RANDOM) == 0, "madvise random");
+  if (memcmp (actual, large, len))
+    fail ("read after dontneed reported bad data");
+
+  CHECK (madvise (map, 4096, 42) == -1, "unknown advice must fail");
+  CHECK (madvise (actual + map_len, 4096, MADV_SEQUENTIAL) == -1,
+         "madvise unmapped range must fail");
+
+  munmap (map);
+  close (handle);
+}
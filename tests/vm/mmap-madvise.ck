@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-madvise) begin
+(mmap-madvise) open "large.txt"
+(mmap-madvise) mmap "large.txt"
+(mmap-madvise) madvise sequential
+(mmap-madvise) madvise dontneed
+(mmap-madvise) madvise willneed
+(mmap-madvise) madvise random
+(mmap-madvise) unknown advice must fail
+(mmap-madvise) madvise unmapped range must fail
+(mmap-madvise) end
+EOF
+pass;
@@ -0,0 +1,46 @@
+/* Writes to a file through a mapping, flushes it with msync,
+   and reads the data back using the read system call while the
+   mapping is still in place. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  int handle;
+  void *map;
+  char buf[1024];
+
+  CHECK (create ("sample.txt", strlen (sample)), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (ACTUAL, 4096, 1, handle, 0)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memcpy (ACTUAL, sample, strlen (sample));
+  CHECK (msync (map, 4096, MS_SYNC) == 0, "msync \"sample.txt\"");
+
+  /* Read back via read() without unmapping. */
+  read (handle, buf, strlen (sample));
+  CHECK (!memcmp (buf, sample, strlen (sample)),
+         "compare read data against written data");
+
+  /* A later store is flushed as well. */
+  ((char *) ACTUAL)[100] = '#';
+  CHECK (msync (map, 4096, MS_SYNC) == 0, "msync again");
+  seek (handle, 100);
+  read (handle, buf, 1);
+  CHECK (buf[0] == '#', "compare modified byte");
+
+  CHECK (msync (map, 4096, MS_ASYNC) == 0, "msync async");
+  CHECK (msync ((char *) map + 1, 4096, MS_SYNC) == -1,
+         "msync misaligned address must fail");
+  CHECK (msync ((char *) map + 4096, 4096, MS_SYNC) == -1,
+         "msync unmapped range must fail");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,44 @@
+/* Maps an anonymous region far larger than user memory, touches
+   only a handful of its pages and unmaps it, several times over.
+   Pages of a mapping must be created on first access, so the cost
+   of mmap and munmap follows the pages actually touched.  The last
+   mapping is left in place for process exit to tear down. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+#define PAGE_SIZE 4096
+#define SIZE (256 * 1024 * 1024)
+#define STRIDE (1024 * PAGE_SIZE)
+#define ROUNDS 8
+
+void
+test_main (void)
+{
+  size_t i;
+  int round;
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      void *map = mmap (ACTUAL, SIZE, 1, MAP_ANONYMOUS, 0);
+      if (map == MAP_FAILED)
+        fail ("mmap failed in round %d", round);
+
+      for (i = 0; i < SIZE; i += STRIDE)
+        {
+          if (ACTUAL[i] != 0)
+            fail ("page %zu is not zeroed in round %d", i / PAGE_SIZE, round);
+          ACTUAL[i] = (char) (i / STRIDE + round);
+        }
+      for (i = 0; i < SIZE; i += STRIDE)
+        if (ACTUAL[i] != (char) (i / STRIDE + round))
+          fail ("page %zu lost its data in round %d", i / PAGE_SIZE, round);
+
+      if (round + 1 < ROUNDS)
+        munmap (map);
+    }
+  msg ("map and unmap sparse region %d times", ROUNDS);
+}
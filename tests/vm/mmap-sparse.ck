@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-sparse) begin
+(mmap-sparse) map and unmap sparse region 8 times
+(mmap-sparse) end
+EOF
+pass;
@@ -0,0 +1,83 @@
+/* Moves the program break with sbrk, including a 1 GB increment
+   that only uses memory for the pages it touches, then builds a
+   linked list and a growing array with malloc and realloc and
+   checks the contents. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define NODE_CNT 2000
+
+struct node
+  {
+    struct node *next;
+    int value;
+    char pad[40];
+  };
+
+void
+test_main (void)
+{
+  char *brk, *p;
+  struct node *head = NULL, *n;
+  int *array = NULL;
+  int i;
+
+  /* sbrk. */
+  brk = sbrk (0);
+  CHECK ((p = sbrk (8192)) == brk, "sbrk grow");
+  for (i = 0; i < 8192; i++)
+    if (p[i] != 0)
+      fail ("byte %d of new heap is %02hhx (should be 0)", i, p[i]);
+  memset (p, 0xcc, 8192);
+  CHECK (sbrk (-8192) == brk + 8192, "sbrk shrink");
+  CHECK (sbrk (0) == brk, "sbrk query");
+  CHECK ((p = sbrk (1L << 30)) == brk, "sbrk 1 GB");
+  p[0] = 1;
+  p[(1L << 30) - 1] = 2;
+  CHECK (sbrk (-(1L << 30)) == brk + (1L << 30), "sbrk 1 GB shrink");
+  CHECK (sbrk (0x48000000L) == (void *) -1,
+         "sbrk into the stack must fail");
+  CHECK (sbrk (-(long) 0x1000000) == (void *) -1,
+         "sbrk below heap start must fail");
+
+  /* malloc. */
+  for (i = 0; i < NODE_CNT; i++)
+    {
+      n = malloc (sizeof *n);
+      if (n == NULL)
+        fail ("malloc failed at node %d", i);
+      n->value = i;
+      n->next = head;
+      head = n;
+    }
+  for (i = NODE_CNT - 1, n = head; n != NULL; n = n->next, i--)
+    if (n->value != i)
+      fail ("node %d has value %d", i, n->value);
+  msg ("malloc list");
+
+  for (i = 0; i < NODE_CNT; i++)
+    {
+      array = realloc (array, (i + 1) * sizeof *array);
+      if (array == NULL)
+        fail ("realloc failed at %d", i);
+      array[i] = i * 3;
+    }
+  for (i = 0; i < NODE_CNT; i++)
+    if (array[i] != i * 3)
+      fail ("array[%d] is %d", i, array[i]);
+  msg ("realloc array");
+
+  while (head != NULL)
+    {
+      n = head->next;
+      free (head);
+      head = n;
+    }
+  free (array);
+  CHECK ((n = calloc (1, sizeof *n)) != NULL && n->value == 0,
+         "calloc reuses freed memory zeroed");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sbrk-malloc) begin
+(sbrk-malloc) sbrk grow
+(sbrk-malloc) sbrk shrink
+(sbrk-malloc) sbrk query
+(sbrk-malloc) sbrk 1 GB
+(sbrk-malloc) sbrk 1 GB shrink
+(sbrk-malloc) sbrk into the stack must fail
+(sbrk-malloc) sbrk below heap start must fail
+(sbrk-malloc) malloc list
+(sbrk-malloc) realloc array
+(sbrk-malloc) calloc reuses freed memory zeroed
+(sbrk-malloc) end
+EOF
+pass;
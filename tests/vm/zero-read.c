@@ -0,0 +1,38 @@
+/* Reads a bss array several times larger than user memory plus
+   swap without ever writing most of it.  Untouched anonymous pages
+   must be served by a shared zero page instead of real frames.
+   Then writes a few pages and checks that they became private. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (8 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char sparse[CHUNK_SIZE];
+
+void
+test_main (void)
+{
+  size_t i, j;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    for (j = 0; j < PAGE_SIZE; j += 1024)
+      if (sparse[i * PAGE_SIZE + j] != 0)
+        fail ("byte %zu of untouched page %zu is nonzero", j, i);
+  msg ("read %d untouched pages", PAGE_COUNT);
+
+  for (i = 0; i < PAGE_COUNT; i += 512)
+    sparse[i * PAGE_SIZE] = (char) (i / 512 + 1);
+  for (i = 0; i < PAGE_COUNT; i++)
+    {
+      char expected = i % 512 ? 0 : (char) (i / 512 + 1);
+      if (sparse[i * PAGE_SIZE] != expected)
+        fail ("page %zu is %02hhx (should be %02hhx)",
+              i, sparse[i * PAGE_SIZE], expected);
+    }
+  msg ("write sparse pages");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-read) begin
+(zero-read) read 2048 untouched pages
+(zero-read) write sparse pages
+(zero-read) end
+EOF
+pass;
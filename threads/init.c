@@ -20,6 +20,7 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -31,11 +32,13 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/evict.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/journal.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -85,7 +88,11 @@ main (void) {
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	slab_init ();
 	paging_init (mem_end);
+#ifdef USERPROG
+	pcid_init ();
+#endif
 
 #ifdef USERPROG
 	tss_init ();
@@ -216,6 +223,8 @@ parse_options (char **argv) {
 #ifdef FILESYS
 		else if (!strcmp (name, "-f"))
 			format_filesys = true;
+		else if (!strcmp (name, "-jcrash"))
+			journal_crash = true;
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
@@ -226,6 +235,14 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-evict")) {
+			if (value == NULL || !evict_policy_select (value))
+				PANIC ("unknown eviction policy `%s' (use -h for help)", value);
+		}
+		else if (!strcmp (name, "-ksm"))
+			vm_ksm_enabled = true;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -324,12 +341,24 @@ usage (void) {
 			"  -h                 Print this help message and power off.\n"
 			"  -q                 Power off VM after actions or on panic.\n"
 			"  -f                 Format file system disk during startup.\n"
+#ifdef FILESYS
+			"  -jcrash            Stop before the last journal checkpoint.\n"
+#endif
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -evict=POLICY      Use POLICY to choose pages to evict.\n"
+			"  -ksm               Merge identical anonymous pages.\n"
 #endif
 			);
+#ifdef VM
+	printf ("Eviction policies: ");
+	evict_policy_print_names ();
+	printf ("\n");
+#endif
 	power_off ();
 }
 
@@ -354,6 +383,7 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -362,4 +392,8 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
+	slab_print_stats ();
 }
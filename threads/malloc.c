@@ -6,7 +6,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -32,7 +34,16 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Size classes and thread caches (P3-EX): descriptors go up in
+   16-byte steps to 256 bytes, then in four steps per power of
+   two up to 1 kB, so a request wastes at most a fifth of its
+   block.  Each thread keeps a few free blocks of every size in
+   its own cache, which malloc() and free() use without taking
+   the descriptor lock.  The cache is refilled from, and returns
+   to, the descriptor CACHE_BATCH blocks at a time, and is given
+   back when the thread exits. */
 
 /* Descriptor. */
 struct desc {
@@ -54,31 +65,86 @@ struct arena {
 
 /* Free block. */
 struct block {
-	struct list_elem free_elem; /* Free list element. */
+	union {
+		struct list_elem free_elem; /* Free list element. */
+		struct block *next;         /* Next block in a thread cache. */
+	};
 };
 
+/* Largest block handled by a descriptor. */
+#define DESC_MAX_SIZE (PGSIZE / 4)
+
+/* Blocks up to this size have a descriptor every 16 bytes. */
+#define DESC_FINE_SIZE 256
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[24];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Free blocks cached by one thread, per descriptor. */
+#define CACHE_MAX 16            /* Most blocks kept per descriptor. */
+#define CACHE_BATCH 8           /* Blocks moved to or from a descriptor. */
+
+struct thread_cache {
+	struct block *head[sizeof descs / sizeof *descs];
+	uint8_t cnt[sizeof descs / sizeof *descs];
+};
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct desc *size_to_desc (size_t size);
+static struct block *desc_get (struct desc *);
+static void desc_put (struct desc *, struct block *);
+static struct thread_cache *get_thread_cache (void);
+static void cache_refill (struct thread_cache *, struct desc *);
+static void cache_return (struct thread_cache *, struct desc *, size_t cnt);
+static bool resize_big_block (struct arena *, size_t new_size);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t block_size = 16;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+	while (block_size <= DESC_MAX_SIZE) {
 		struct desc *d = &descs[desc_cnt++];
 		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
 		d->block_size = block_size;
 		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
 		list_init (&d->free_list);
 		lock_init (&d->lock);
+
+		if (block_size < DESC_FINE_SIZE)
+			block_size += 16;
+		else {
+			/* A quarter of the power of two at or below BLOCK_SIZE. */
+			size_t step = DESC_FINE_SIZE;
+			while (step * 2 <= block_size)
+				step *= 2;
+			block_size += step / 4;
+		}
 	}
 }
 
+/* Gives the calling thread's cached blocks back to their
+   descriptors.  Called by thread_exit(). */
+void
+malloc_thread_exit (void) {
+	struct thread *t = thread_current ();
+	struct thread_cache *c = t->malloc_cache;
+	size_t i;
+
+	if (c == NULL)
+		return;
+	for (i = 0; i < desc_cnt; i++)
+		cache_return (c, &descs[i], c->cnt[i]);
+
+	t->malloc_cache = NULL;
+	struct desc *d = size_to_desc (sizeof *c);
+	lock_acquire (&d->lock);
+	desc_put (d, (struct block *) c);
+	lock_release (&d->lock);
+}
+
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
@@ -93,10 +159,8 @@ malloc (size_t size) {
 
 	/* Find the smallest descriptor that satisfies a SIZE-byte
 	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	d = size_to_desc (size);
+	if (d == NULL) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
@@ -112,33 +176,24 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
+	/* Take a block from this thread's cache, refilling it from
+	   the descriptor if it is empty. */
+	struct thread_cache *c = get_thread_cache ();
+	if (c != NULL) {
+		size_t idx = d - descs;
 
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
-
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
+		if (c->cnt[idx] == 0)
+			cache_refill (c, d);
+		if (c->cnt[idx] == 0)
 			return NULL;
-		}
-
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
+		b = c->head[idx];
+		c->head[idx] = b->next;
+		c->cnt[idx]--;
+		return b;
 	}
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
+	lock_acquire (&d->lock);
+	b = desc_get (d);
 	lock_release (&d->lock);
 	return b;
 }
@@ -174,7 +229,9 @@ block_size (void *block) {
 }
 
 /* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
-   moving it in the process.
+   moving it in the process.  The block is not moved if it still
+   fits, or if it is a big block and the pages right after it
+   are free.
    If successful, returns the new block; on failure, returns a
    null pointer.
    A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
@@ -184,6 +241,13 @@ realloc (void *old_block, size_t new_size) {
 	if (new_size == 0) {
 		free (old_block);
 		return NULL;
+	} else if (old_block != NULL && block_to_arena (old_block)->desc == NULL
+			&& resize_big_block (block_to_arena (old_block), new_size)) {
+		/* Resized the big block without moving it. */
+		return old_block;
+	} else if (old_block != NULL && new_size <= block_size (old_block)) {
+		/* Still fits in the block. */
+		return old_block;
 	} else {
 		void *new_block = malloc (new_size);
 		if (old_block != NULL && new_block != NULL) {
@@ -197,10 +261,16 @@ realloc (void *old_block, size_t new_size) {
 }
 
 /* Frees block P, which must have been previously allocated with
-   malloc(), calloc(), or realloc(). */
+   malloc(), calloc(), or realloc(), or with slab_alloc(). */
 void
 free (void *p) {
 	if (p != NULL) {
+		if (slab_owns (p)) {
+			/* It's an object from a slab cache. (P3-EX) */
+			slab_free (p);
+			return;
+		}
+
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
 		struct desc *d = a->desc;
@@ -213,23 +283,22 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			/* Keep it in this thread's cache, first returning a
+			   batch to the descriptor if the cache is full. */
+			struct thread_cache *c = get_thread_cache ();
+			if (c != NULL) {
+				size_t idx = d - descs;
+
+				if (c->cnt[idx] >= CACHE_MAX)
+					cache_return (c, d, CACHE_BATCH);
+				b->next = c->head[idx];
+				c->head[idx] = b;
+				c->cnt[idx]++;
+				return;
 			}
 
+			lock_acquire (&d->lock);
+			desc_put (d, b);
 			lock_release (&d->lock);
 		} else {
 			/* It's a big block.  Free its pages. */
@@ -239,6 +308,156 @@ free (void *p) {
 	}
 }
 
+/* Returns the smallest descriptor whose blocks hold SIZE bytes,
+   or a null pointer if SIZE needs a big block. */
+static struct desc *
+size_to_desc (size_t size) {
+	struct desc *d;
+
+	ASSERT (size > 0);
+	if (size <= DESC_FINE_SIZE)
+		return &descs[(size - 1) / 16];
+	for (d = descs + DESC_FINE_SIZE / 16; d < descs + desc_cnt; d++)
+		if (d->block_size >= size)
+			return d;
+	return NULL;
+}
+
+/* Takes a block from D's free list, creating a new arena if the
+   list is empty.  Returns a null pointer if memory is not
+   available.  D's lock must be held. */
+static struct block *
+desc_get (struct desc *d) {
+	struct block *b;
+	struct arena *a;
+
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	/* If the free list is empty, create a new arena. */
+	if (list_empty (&d->free_list)) {
+		size_t i;
+
+		/* Allocate a page. */
+		a = palloc_get_page (0);
+		if (a == NULL)
+			return NULL;
+
+		/* Initialize arena and add its blocks to the free list. */
+		a->magic = ARENA_MAGIC;
+		a->desc = d;
+		a->free_cnt = d->blocks_per_arena;
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_push_back (&d->free_list, &b->free_elem);
+		}
+	}
+
+	/* Get a block from free list and return it. */
+	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+	a = block_to_arena (b);
+	a->free_cnt--;
+	return b;
+}
+
+/* Returns block B to D's free list, freeing its arena if it is
+   now entirely unused.  D's lock must be held. */
+static void
+desc_put (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		palloc_free_page (a);
+	}
+}
+
+/* Returns the running thread's block cache, creating it on first
+   use.  Returns a null pointer if there is no memory for it. */
+static struct thread_cache *
+get_thread_cache (void) {
+	struct thread *t = thread_current ();
+
+	if (t->malloc_cache == NULL) {
+		/* The cache itself comes straight from its descriptor. */
+		struct desc *d = size_to_desc (sizeof (struct thread_cache));
+		struct thread_cache *c;
+
+		lock_acquire (&d->lock);
+		c = (struct thread_cache *) desc_get (d);
+		lock_release (&d->lock);
+		if (c != NULL)
+			memset (c, 0, sizeof *c);
+		t->malloc_cache = c;
+	}
+	return t->malloc_cache;
+}
+
+/* Moves up to CACHE_BATCH blocks from D into cache C. */
+static void
+cache_refill (struct thread_cache *c, struct desc *d) {
+	size_t idx = d - descs;
+	size_t i;
+
+	lock_acquire (&d->lock);
+	for (i = 0; i < CACHE_BATCH; i++) {
+		struct block *b = desc_get (d);
+		if (b == NULL)
+			break;
+		b->next = c->head[idx];
+		c->head[idx] = b;
+		c->cnt[idx]++;
+	}
+	lock_release (&d->lock);
+}
+
+/* Moves up to CNT blocks from cache C back to D. */
+static void
+cache_return (struct thread_cache *c, struct desc *d, size_t cnt) {
+	size_t idx = d - descs;
+
+	if (cnt == 0)
+		return;
+	lock_acquire (&d->lock);
+	while (cnt-- > 0 && c->cnt[idx] > 0) {
+		struct block *b = c->head[idx];
+		c->head[idx] = b->next;
+		c->cnt[idx]--;
+		desc_put (d, b);
+	}
+	lock_release (&d->lock);
+}
+
+/* Resizes the big block whose arena is A to hold NEW_SIZE bytes
+   without moving it: grows into the pages right after it if the
+   page allocator has them free, or frees the pages it no longer
+   needs.  Returns false if it cannot grow in place. */
+static bool
+resize_big_block (struct arena *a, size_t new_size) {
+	size_t page_cnt = DIV_ROUND_UP (new_size + sizeof *a, PGSIZE);
+
+	ASSERT (a->desc == NULL);
+	if (page_cnt > a->free_cnt) {
+		if (!palloc_get_multiple_at (a, a->free_cnt, page_cnt - a->free_cnt))
+			return false;
+	} else if (page_cnt < a->free_cnt)
+		palloc_free_multiple ((uint8_t *) a + page_cnt * PGSIZE,
+				a->free_cnt - page_cnt);
+	a->free_cnt = page_cnt;
+	return true;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -4,10 +4,41 @@
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "threads/interrupt.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers (P3-EX).
+ * CPU가 PCID를 지원하면 pml4마다 PCID를 붙여서, 프로세스를 바꿀 때 CR3를
+ * 다시 불러와도 TLB 전체를 비우지 않음 (그 pml4의 entry는 다음 time slice까지 유지)
+ * 지원하지 않는 CPU 모델에서는 기존처럼 CR3를 바꿀 때마다 TLB를 비움 */
+#define PCID_CNT 4096 // CR3의 하위 12 bit
+#define CR3_PCID_MASK 0xfffULL
+#define CR3_NOFLUSH (1ULL << 63) // CR3를 불러올 때 해당 PCID의 entry를 유지
+#define CR4_PCIDE (1ULL << 17)
+#define CPUID_1_ECX_PCID (1 << 17)
+#define CPUID_7_EBX_INVPCID (1 << 10)
+#define INVPCID_ADDR 0 // 한 PCID의 한 주소만 무효화
+
+static bool pcid_enabled;
+static bool invpcid_enabled;
+static uint16_t *pml4_pcid; // kernel pool의 페이지 번호 -> pml4의 PCID (0이면 없음)
+static uint8_t *pml4_pcid_base; // kernel pool의 첫 번째 페이지
+static size_t pml4_pcid_cnt;
+static bool pcid_used[PCID_CNT];
+// 다른 pml4의 pte를 바꾸었지만 INVPCID가 없어 아직 무효화하지 못한 PCID
+// 다음 activate에서 NOFLUSH 없이 CR3를 불러 그 PCID의 entry만 비움
+static bool pcid_stale[PCID_CNT];
+static uint16_t pcid_next = 1; // PCID 0은 base_pml4와 PCID를 받지 못한 pml4가 사용
+
+static void pcid_assign (uint64_t *pml4);
+static void pcid_release (uint64_t *pml4);
+static uint16_t pml4_get_pcid (uint64_t *pml4);
+static void tlb_invalidate (uint64_t *pml4, const void *va);
+static void tlb_invalidate_all (uint64_t *pml4);
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -95,8 +126,10 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 uint64_t *
 pml4_create (void) {
 	uint64_t *pml4 = palloc_get_page (0);
-	if (pml4)
+	if (pml4) {
 		memcpy (pml4, base_pml4, PGSIZE);
+		pcid_assign (pml4);
+	}
 	return pml4;
 }
 
@@ -196,6 +229,7 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+	pcid_release (pml4);
 	palloc_free_page ((void *) pml4);
 }
 
@@ -203,7 +237,128 @@ pml4_destroy (uint64_t *pml4) {
  * register. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+
+	uint64_t cr3 = vtop (pml4);
+	if (pcid_enabled) {
+		// PCID 0은 여러 pml4가 같이 쓰므로 항상 비움
+		uint16_t pcid = pml4_get_pcid (pml4);
+		cr3 |= pcid;
+		if (pcid != 0 && !pcid_stale[pcid])
+			cr3 |= CR3_NOFLUSH;
+		pcid_stale[pcid] = false;
+	}
+	lcr3 (cr3);
+}
+
+// P3-EX
+/* Enables process-context identifiers if the CPU supports them.
+ * Must be called once after paging_init(), while CR3 holds
+ * base_pml4 with PCID 0. */
+void
+pcid_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, 0, &eax, &ebx, &ecx, &edx);
+	if (!(ecx & CPUID_1_ECX_PCID))
+		return; // QEMU의 기본 CPU 모델 등: 기존처럼 동작
+
+	pml4_pcid_base = palloc_pool_base (0);
+	pml4_pcid_cnt = palloc_page_cnt (0);
+	pml4_pcid = calloc (pml4_pcid_cnt, sizeof *pml4_pcid);
+	if (pml4_pcid == NULL)
+		return;
+
+	cpuid (0, 0, &eax, &ebx, &ecx, &edx);
+	if (eax >= 7) {
+		cpuid (7, 0, &eax, &ebx, &ecx, &edx);
+		invpcid_enabled = (ebx & CPUID_7_EBX_INVPCID) != 0;
+	}
+
+	ASSERT ((rcr3 () & CR3_PCID_MASK) == 0);
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+// 새 pml4에 사용하지 않는 PCID를 붙임, 모두 사용중이면 PCID 0을 사용
+static void
+pcid_assign (uint64_t *pml4) {
+	if (!pcid_enabled)
+		return;
+
+	enum intr_level old_level = intr_disable ();
+	for (unsigned i = 0; i < PCID_CNT - 1; i++) {
+		uint16_t pcid = pcid_next;
+		pcid_next = pcid_next + 1 < PCID_CNT ? pcid_next + 1 : 1;
+		if (!pcid_used[pcid]) {
+			pcid_used[pcid] = true;
+			// 이전에 같은 PCID를 쓰던 pml4의 entry가 남아있을 수 있음
+			pcid_stale[pcid] = true;
+			pml4_pcid[((uint8_t *) pml4 - pml4_pcid_base) / PGSIZE] = pcid;
+			break;
+		}
+	}
+	intr_set_level (old_level);
+}
+
+static void
+pcid_release (uint64_t *pml4) {
+	if (!pcid_enabled)
+		return;
+
+	enum intr_level old_level = intr_disable ();
+	uint16_t pcid = pml4_get_pcid (pml4);
+	pcid_used[pcid] = false;
+	pml4_pcid[((uint8_t *) pml4 - pml4_pcid_base) / PGSIZE] = 0;
+	intr_set_level (old_level);
+}
+
+static uint16_t
+pml4_get_pcid (uint64_t *pml4) {
+	size_t idx = ((uint8_t *) pml4 - pml4_pcid_base) / PGSIZE;
+	if (pml4 == base_pml4 || idx >= pml4_pcid_cnt)
+		return 0;
+	return pml4_pcid[idx];
+}
+
+// PML4의 VA에 대한 TLB entry를 무효화
+// 다른 pml4라면 PCID를 쓰지 않을 때는 CR3를 바꿀 때 비워지므로 무시해도 되지만,
+// PCID를 쓰면 entry가 남아있으므로 INVPCID로 지우거나 다음 activate 때 비움
+// (kernel 주소의 entry는 모든 PCID에 남을 수 있지만, kernel pte의 dirty/accessed
+//  bit은 소프트웨어로만 옮겨 적으므로 문제 없음)
+static void
+tlb_invalidate (uint64_t *pml4, const void *va) {
+	if ((rcr3 () & ~CR3_PCID_MASK) == vtop (pml4)) {
+		invlpg ((uint64_t) va);
+		return;
+	}
+	if (!pcid_enabled)
+		return;
+
+	uint16_t pcid = pml4_get_pcid (pml4);
+	if (pcid == 0)
+		return; // activate할 때마다 비워짐
+	if (invpcid_enabled)
+		invpcid (INVPCID_ADDR, pcid, (uint64_t) va);
+	else
+		pcid_stale[pcid] = true;
+}
+
+// PML4의 TLB entry를 모두 무효화
+static void
+tlb_invalidate_all (uint64_t *pml4) {
+	uint64_t cr3 = rcr3 ();
+	if ((cr3 & ~CR3_PCID_MASK) == vtop (pml4)) {
+		// NOFLUSH 없이 다시 불러오면 현재 PCID의 entry만 비워짐
+		lcr3 (cr3);
+		return;
+	}
+	if (pcid_enabled) {
+		uint16_t pcid = pml4_get_pcid (pml4);
+		if (pcid != 0)
+			pcid_stale[pcid] = true;
+	}
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -238,8 +393,13 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		// P3-EX: 이미 매핑된 페이지를 교체 (zero 페이지, 병합된 페이지 등)
+		bool present = (*pte & PTE_P) != 0;
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (present)
+			tlb_invalidate (pml4, upage);
+	}
 	return pte != NULL;
 }
 
@@ -257,9 +417,63 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_invalidate (pml4, upage);
+	}
+}
+
+// P3
+// pml4e_walk 호출 없이 바로 pte를 인자로 받는 함수
+void
+pml4_pte_clear_page (uint64_t *pml4, uint64_t *pte, void *upage) {
+	ASSERT (pte != NULL);
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	if ((*pte & PTE_P) != 0) {
+		*pte &= ~PTE_P;
+		tlb_invalidate (pml4, upage);
+	}
+}
+
+// P3-EX
+void
+tlb_gather_init (struct tlb_gather *tlb, uint64_t *pml4) {
+	tlb->pml4 = pml4;
+	tlb->cnt = 0;
+	tlb->full = false;
+}
+
+// pml4_pte_clear_page()와 같지만 TLB 무효화는 tlb_gather_flush()까지 미룸
+void
+tlb_gather_clear_page (struct tlb_gather *tlb, uint64_t *pte, void *upage) {
+	ASSERT (pte != NULL);
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	if ((*pte & PTE_P) == 0)
+		return;
+	*pte &= ~PTE_P;
+
+	if (tlb->full)
+		return;
+	if (tlb->cnt < TLB_GATHER_MAX)
+		tlb->va[tlb->cnt++] = upage;
+	else
+		tlb->full = true;
+}
+
+// 모아둔 페이지의 TLB entry를 무효화
+// 적으면 하나씩, 많으면 pml4의 TLB entry 전체를 한 번에 비움
+void
+tlb_gather_flush (struct tlb_gather *tlb) {
+	if (tlb->full) {
+		tlb_invalidate_all (tlb->pml4);
+	} else {
+		for (size_t i = 0; i < tlb->cnt; i++)
+			tlb_invalidate (tlb->pml4, tlb->va[i]);
 	}
+	tlb->cnt = 0;
+	tlb->full = false;
 }
 
 /* Returns true if the PTE for virtual page VPAGE in PML4 is dirty,
@@ -283,8 +497,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -300,8 +513,7 @@ pml4_pte_set_dirty (uint64_t *pml4, uint64_t *pte, const void *vpage, bool dirty
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -326,8 +538,7 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -343,8 +554,7 @@ pml4_pte_set_accessed (uint64_t *pml4, uint64_t *pte, const void *vpage, bool ac
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
 
@@ -357,7 +567,6 @@ pml4_set_writable (uint64_t *pml4, const void *vpage, bool writable) {
 		else
 			*pte &= ~(uint32_t) PTE_W;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, vpage);
 	}
 }
\ No newline at end of file
@@ -2,12 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -24,13 +26,37 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Free pages of each pool are managed by a binary buddy
+   allocator (P3-EX).  A free block of order K is 2**K pages
+   aligned to 2**K pages from the pool base, and sits on the
+   free list of its order.  A request takes the smallest free
+   block that fits, splitting larger ones in halves, and a freed
+   block is merged with its buddy while the buddy is free too.
+   Pages beyond the request in a power-of-two block are freed
+   right away, so requests of any size waste nothing.
+
+   palloc_free_multiple() may be called from the scheduler with
+   interrupts off, so the free lists are protected by disabling
+   interrupts instead of a lock.  Every operation touches at most
+   two blocks per order. */
+
+/* Largest block is 2**PAL_MAX_ORDER pages. */
+#define PAL_MAX_ORDER 20
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Number of free pages. */
+
+	/* Buddy allocator. */
+	struct list free_list[PAL_MAX_ORDER + 1];  /* Free blocks by order. */
+	size_t block_cnt[PAL_MAX_ORDER + 1];       /* Length of free_list. */
+	struct list_elem *block_elem;   /* Free list elem of each page. */
+	uint8_t *order_map;             /* Order + 1 of the free block
+	                                   starting at each page, or 0. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +68,13 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void pool_add_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static unsigned order_for (size_t page_cnt);
+static size_t buddy_alloc (struct pool *, unsigned order);
+static void buddy_free (struct pool *, size_t page_idx, unsigned order);
+static void buddy_free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void buddy_take_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void print_pool_stats (const char *name, const struct pool *);
 
 /* multiboot info */
 struct multiboot_info {
@@ -223,12 +256,12 @@ split:
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_add_pages (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_add_pages (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,10 +295,22 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	unsigned order = order_for (page_cnt);
+	size_t page_idx = BITMAP_ERROR;
+
+	if (page_cnt > 0 && order <= PAL_MAX_ORDER) {
+		enum intr_level old_level = intr_disable ();
+		page_idx = buddy_alloc (pool, order);
+		if (page_idx != BITMAP_ERROR) {
+			// 2**order 페이지 중 요청보다 남는 뒤쪽 페이지는 바로 반환
+			buddy_free_range (pool, page_idx + page_cnt,
+					((size_t) 1 << order) - page_cnt);
+			ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+			bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+			pool->free_cnt -= page_cnt;
+		}
+		intr_set_level (old_level);
+	}
 	void *pages;
 
 	if (page_idx != BITMAP_ERROR)
@@ -284,6 +329,42 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Obtains the PAGE_CNT pages right after the BLOCK_CNT pages
+   starting at BLOCK, to grow that allocation in place.  The new
+   pages must all be free and in the same pool as BLOCK; the
+   kernel and user pools are contiguous, so a block at the end of
+   one pool must not grow into the other.  Returns true if
+   successful, false otherwise. */
+bool
+palloc_get_multiple_at (void *block, size_t block_cnt, size_t page_cnt) {
+	struct pool *pool;
+	size_t page_idx;
+	bool success = false;
+
+	ASSERT (pg_ofs (block) == 0);
+	if (page_from_pool (&kernel_pool, block))
+		pool = &kernel_pool;
+	else if (page_from_pool (&user_pool, block))
+		pool = &user_pool;
+	else
+		return false;
+
+	page_idx = pg_no (block) - pg_no (pool->base) + block_cnt;
+	if (page_cnt == 0 || page_idx > bitmap_size (pool->used_map)
+			|| page_cnt > bitmap_size (pool->used_map) - page_idx)
+		return false;
+
+	enum intr_level old_level = intr_disable ();
+	if (bitmap_none (pool->used_map, page_idx, page_cnt)) {
+		buddy_take_range (pool, page_idx, page_cnt);
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+		pool->free_cnt -= page_cnt;
+		success = true;
+	}
+	intr_set_level (old_level);
+	return success;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -318,8 +399,16 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+
+	/* May be called from the scheduler with interrupts off, so
+	   the pool is protected by disabling interrupts, not by a
+	   lock. */
+	enum intr_level old_level = intr_disable ();
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free_range (pool, page_idx, page_cnt);
+	pool->free_cnt += page_cnt;
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -328,25 +417,222 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free pages in the user pool if PAL_USER
+   is set in FLAGS, otherwise in the kernel pool.  The count may
+   be stale by the time the caller looks at it. */
+size_t
+palloc_free_cnt (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	return pool->free_cnt;
+}
+
+/* Returns the kernel virtual address of the first page of the
+   user pool if PAL_USER is set in FLAGS, otherwise of the kernel
+   pool.  Pages of a pool are contiguous from this address. */
+void *
+palloc_pool_base (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	return pool->base;
+}
+
+/* Returns the total number of pages managed by the user pool if
+   PAL_USER is set in FLAGS, otherwise by the kernel pool. */
+size_t
+palloc_page_cnt (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	return bitmap_size (pool->used_map);
+}
+
+/* Prints the free blocks of each order in both pools. */
+void
+palloc_print_stats (void) {
+	print_pool_stats ("Kernel", &kernel_pool);
+	print_pool_stats ("User", &user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's used_map and the buddy allocator's
+     per-page metadata at its base.
+     Calculate the space needed for them
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t bm_size = ROUND_UP (bitmap_buf_size (pgcnt), sizeof (void *));
+	size_t elem_size = pgcnt * sizeof *p->block_elem;
+	size_t bm_pages = DIV_ROUND_UP (bm_size + elem_size + pgcnt, PGSIZE) * PGSIZE;
+	unsigned order;
 
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->free_cnt = 0;
+	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_size);
 	p->base = (void *) start;
+	p->block_elem = (struct list_elem *) ((uint8_t *) *bm_base + bm_size);
+	p->order_map = (uint8_t *) p->block_elem + elem_size;
+	for (order = 0; order <= PAL_MAX_ORDER; order++) {
+		list_init (&p->free_list[order]);
+		p->block_cnt[order] = 0;
+	}
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset (p->order_map, 0, pgcnt);
 
 	*bm_base += bm_pages;
 }
 
+/* Marks PAGE_CNT pages starting at PAGE_IDX in P usable. */
+static void
+pool_add_pages (struct pool *p, size_t page_idx, size_t page_cnt) {
+	bitmap_set_multiple (p->used_map, page_idx, page_cnt, false);
+	buddy_free_range (p, page_idx, page_cnt);
+	p->free_cnt += page_cnt;
+}
+
+/* Returns the smallest order whose block holds PAGE_CNT pages. */
+static unsigned
+order_for (size_t page_cnt) {
+	unsigned order = 0;
+
+	while (((size_t) 1 << order) < page_cnt)
+		order++;
+	return order;
+}
+
+/* Takes a free block of ORDER out of P, splitting a larger
+   block if needed, and returns the index of its first page.
+   Returns BITMAP_ERROR if no block is large enough.
+   Must be called with interrupts off. */
+static size_t
+buddy_alloc (struct pool *p, unsigned order) {
+	unsigned cur;
+	size_t page_idx;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	// 요청을 담을 수 있는 가장 작은 free 블록을 찾음
+	for (cur = order; cur <= PAL_MAX_ORDER; cur++)
+		if (!list_empty (&p->free_list[cur]))
+			break;
+	if (cur > PAL_MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = list_pop_front (&p->free_list[cur]) - p->block_elem;
+	p->block_cnt[cur]--;
+	p->order_map[page_idx] = 0;
+
+	// 필요한 크기가 될 때까지 반으로 나누어 뒤쪽 절반을 free 리스트에 넣음
+	while (cur > order) {
+		size_t buddy_idx;
+
+		cur--;
+		buddy_idx = page_idx + ((size_t) 1 << cur);
+		p->order_map[buddy_idx] = cur + 1;
+		list_push_front (&p->free_list[cur], &p->block_elem[buddy_idx]);
+		p->block_cnt[cur]++;
+	}
+	return page_idx;
+}
+
+/* Returns the block of ORDER at PAGE_IDX to P, merging it with
+   its buddy as long as the buddy is a free block of the same
+   order.  Must be called with interrupts off. */
+static void
+buddy_free (struct pool *p, size_t page_idx, unsigned order) {
+	size_t page_cnt = bitmap_size (p->used_map);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (page_idx % ((size_t) 1 << order) == 0);
+
+	while (order < PAL_MAX_ORDER) {
+		size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy_idx >= page_cnt || p->order_map[buddy_idx] != order + 1)
+			break;
+
+		// buddy도 같은 크기의 free 블록: 꺼내서 합침
+		list_remove (&p->block_elem[buddy_idx]);
+		p->block_cnt[order]--;
+		p->order_map[buddy_idx] = 0;
+		if (buddy_idx < page_idx)
+			page_idx = buddy_idx;
+		order++;
+	}
+
+	p->order_map[page_idx] = order + 1;
+	list_push_front (&p->free_list[order], &p->block_elem[page_idx]);
+	p->block_cnt[order]++;
+}
+
+/* Returns PAGE_CNT pages starting at PAGE_IDX to P as the
+   largest aligned blocks that cover them.
+   Must be called with interrupts off. */
+static void
+buddy_free_range (struct pool *p, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		unsigned order = 0;
+
+		while (order < PAL_MAX_ORDER
+				&& page_idx % ((size_t) 2 << order) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		buddy_free (p, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Takes PAGE_CNT free pages starting at PAGE_IDX out of the free
+   blocks of P.  Each block that holds some of them is removed
+   and its pages outside the range are freed again.
+   Must be called with interrupts off. */
+static void
+buddy_take_range (struct pool *p, size_t page_idx, size_t page_cnt) {
+	size_t end = page_idx + page_cnt;
+
+	while (page_idx < end) {
+		size_t head, block_end;
+		unsigned order;
+
+		// page_idx를 포함하는 free 블록을 찾음
+		for (order = 0; ; order++) {
+			ASSERT (order <= PAL_MAX_ORDER);
+			head = page_idx & ~(((size_t) 1 << order) - 1);
+			if (p->order_map[head] == order + 1)
+				break;
+		}
+		block_end = head + ((size_t) 1 << order);
+
+		list_remove (&p->block_elem[head]);
+		p->block_cnt[order]--;
+		p->order_map[head] = 0;
+
+		// 블록 중 범위 앞뒤의 페이지는 다시 free 블록으로
+		buddy_free_range (p, head, page_idx - head);
+		if (block_end > end) {
+			buddy_free_range (p, end, block_end - end);
+			block_end = end;
+		}
+		page_idx = block_end;
+	}
+}
+
+/* Prints the free page count and the free blocks of each order
+   of pool P, up to its largest free block. */
+static void
+print_pool_stats (const char *name, const struct pool *p) {
+	int order, max_order = -1;
+
+	for (order = 0; order <= PAL_MAX_ORDER; order++)
+		if (p->block_cnt[order] > 0)
+			max_order = order;
+
+	printf ("%s pool: %zu of %zu pages free, free blocks by order:",
+			name, p->free_cnt, bitmap_size (p->used_map));
+	for (order = 0; order <= max_order; order++)
+		printf (" %zu", p->block_cnt[order]);
+	printf ("\n");
+}
+
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
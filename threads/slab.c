@@ -0,0 +1,282 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator (P3-EX).
+ * fault 경로에서 자주 할당하는 고정 크기 구조체 (struct page, frame 등)를
+ * 종류별 cache에서 할당함. 각 cache는 페이지 단위의 slab을 object로 나누어 쓰고,
+ * 최근에 해제된 object를 magazine에 모아두었다가 바로 돌려줌.
+ * CPU가 하나이므로 magazine은 lock 대신 interrupt를 끄고 접근하며,
+ * magazine이 비거나 가득 찼을 때만 cache lock을 잡고 slab과 주고받음.
+ *
+ * slab 페이지의 맨 앞에는 header가 있으므로 free()에서도
+ * slab_owns()로 구분하여 slab_free()로 넘길 수 있음. */
+
+/* Magic number for detecting slab pages. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab: 페이지 맨 앞의 header, 뒤이어 free object 번호의 stack과 object들. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct slab_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* cache->partial or cache->full. */
+	uint16_t free_cnt;          /* Number of free objects. */
+	uint16_t free_idx[];        /* Indexes of free objects. */
+};
+
+static struct list all_caches;  /* slab_print_stats()를 위한 모든 cache. */
+
+static bool slab_grow (struct slab_cache *);
+static void *slab_take (struct slab_cache *, bool grow);
+static void slab_put (struct slab_cache *, void *obj);
+static void slab_refill (struct slab_cache *);
+static void slab_drain (struct slab_cache *);
+static void *slab_obj (struct slab *, size_t idx);
+
+/* Initializes the slab allocator. */
+void
+slab_init (void) {
+	list_init (&all_caches);
+}
+
+/* Initializes cache C for objects of SIZE bytes.  If CTOR is not
+   null, it is called once on every object when its slab is
+   created, and objects must be in that constructed state again
+   when they are freed. */
+void
+slab_cache_init (struct slab_cache *c, const char *name, size_t size,
+		void (*ctor) (void *)) {
+	size_t hdr = sizeof (struct slab);
+	size_t n;
+
+	size = ROUND_UP (size, sizeof (void *));
+	n = (PGSIZE - hdr) / (size + sizeof (uint16_t));
+	while (n > 0 && ROUND_UP (hdr + n * sizeof (uint16_t), 16) + n * size > PGSIZE)
+		n--;
+	ASSERT (n > 0 && n <= UINT16_MAX);
+
+	c->name = name;
+	c->obj_size = size;
+	c->obj_cnt = n;
+	c->obj_ofs = ROUND_UP (hdr + n * sizeof (uint16_t), 16);
+	c->ctor = ctor;
+	lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	c->mag_cnt = 0;
+	c->alloc_cnt = c->hit_cnt = c->in_use = c->slab_cnt = 0;
+	list_push_back (&all_caches, &c->elem);
+}
+
+/* Obtains a free object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *c) {
+	enum intr_level old_level;
+	void *obj = NULL;
+
+	ASSERT (!intr_context ());
+
+	// 대부분은 magazine에서 lock 없이 바로 가져감
+	old_level = intr_disable ();
+	c->alloc_cnt++;
+	if (c->mag_cnt > 0) {
+		obj = c->mag[--c->mag_cnt];
+		c->hit_cnt++;
+		c->in_use++;
+	}
+	intr_set_level (old_level);
+	if (obj != NULL)
+		return obj;
+
+	// magazine이 비었음: slab에서 하나를 가져오면서 magazine을 절반 채움
+	lock_acquire (&c->lock);
+	obj = slab_take (c, true);
+	if (obj != NULL)
+		slab_refill (c);
+	lock_release (&c->lock);
+
+	if (obj != NULL) {
+		old_level = intr_disable ();
+		c->in_use++;
+		intr_set_level (old_level);
+	}
+	return obj;
+}
+
+/* Frees OBJ, which must have been obtained with slab_alloc(). */
+void
+slab_free (void *obj) {
+	enum intr_level old_level;
+	struct slab_cache *c;
+	bool stored = false;
+
+	if (obj == NULL)
+		return;
+	ASSERT (slab_owns (obj));
+	ASSERT (!intr_context ());
+	c = ((struct slab *) pg_round_down (obj))->cache;
+
+	old_level = intr_disable ();
+	c->in_use--;
+	if (c->mag_cnt < SLAB_MAG_SIZE) {
+		c->mag[c->mag_cnt++] = obj;
+		stored = true;
+	}
+	intr_set_level (old_level);
+	if (stored)
+		return;
+
+	// magazine이 가득 참: 이 object와 magazine의 절반을 slab에 돌려줌
+	lock_acquire (&c->lock);
+	slab_put (c, obj);
+	slab_drain (c);
+	lock_release (&c->lock);
+}
+
+/* Returns true if P points into a slab page. */
+bool
+slab_owns (const void *p) {
+	const struct slab *s = pg_round_down (p);
+	return s->magic == SLAB_MAGIC;
+}
+
+/* Prints statistics of every cache. */
+void
+slab_print_stats (void) {
+	struct list_elem *e;
+
+	for (e = list_begin (&all_caches); e != list_end (&all_caches);
+			e = list_next (e)) {
+		struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+		size_t hit_rate = c->alloc_cnt ? c->hit_cnt * 100 / c->alloc_cnt : 0;
+		printf ("Slab %s: %zu objs in use, %zu slabs (%zu bytes), "
+				"%zu allocs, %zu%% from magazine\n",
+				c->name, c->in_use, c->slab_cnt, c->slab_cnt * PGSIZE,
+				c->alloc_cnt, hit_rate);
+	}
+}
+
+// 새 slab 페이지를 할당하여 partial 리스트에 추가, c->lock을 잡은 상태로 호출
+static bool
+slab_grow (struct slab_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	size_t i;
+
+	if (s == NULL)
+		return false;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->free_cnt = c->obj_cnt;
+	for (i = 0; i < c->obj_cnt; i++) {
+		s->free_idx[i] = c->obj_cnt - 1 - i; // 앞의 object부터 사용
+		if (c->ctor != NULL)
+			c->ctor (slab_obj (s, i));
+	}
+	list_push_front (&c->partial, &s->elem);
+	c->slab_cnt++;
+	return true;
+}
+
+// slab에서 free object 하나를 꺼냄, c->lock을 잡은 상태로 호출
+// GROW가 false라면 free object가 남은 slab이 없을 때 새로 할당하지 않음
+static void *
+slab_take (struct slab_cache *c, bool grow) {
+	struct slab *s;
+	void *obj;
+
+	if (list_empty (&c->partial) && (!grow || !slab_grow (c)))
+		return NULL;
+
+	s = list_entry (list_front (&c->partial), struct slab, elem);
+	ASSERT (s->free_cnt > 0);
+	obj = slab_obj (s, s->free_idx[--s->free_cnt]);
+	if (s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_back (&c->full, &s->elem);
+	}
+	return obj;
+}
+
+// object를 slab에 돌려줌, c->lock을 잡은 상태로 호출
+// slab이 모두 비었고 free object가 남은 다른 slab이 있으면 페이지를 반환
+static void
+slab_put (struct slab_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+	size_t ofs = (uint8_t *) obj - (uint8_t *) s - c->obj_ofs;
+
+	ASSERT (s->magic == SLAB_MAGIC && s->cache == c);
+	ASSERT (ofs % c->obj_size == 0 && ofs / c->obj_size < c->obj_cnt);
+
+	if (s->free_cnt == 0) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	s->free_idx[s->free_cnt++] = ofs / c->obj_size;
+
+	if (s->free_cnt == c->obj_cnt
+			&& list_front (&c->partial) != list_back (&c->partial)) {
+		list_remove (&s->elem);
+		s->magic = 0;
+		palloc_free_page (s);
+		c->slab_cnt--;
+	}
+}
+
+// magazine을 최대 절반까지 채움, c->lock을 잡은 상태로 호출
+// 새 slab은 할당하지 않고 이미 있는 slab의 free object만 가져옴
+static void
+slab_refill (struct slab_cache *c) {
+	enum intr_level old_level;
+	size_t i;
+
+	for (i = 0; i < SLAB_MAG_SIZE / 2; i++) {
+		void *obj = slab_take (c, false);
+		bool stored = false;
+
+		if (obj == NULL)
+			break;
+		// lock 없이 접근하는 다른 쓰레드가 그 사이에 채웠을 수 있음
+		old_level = intr_disable ();
+		if (c->mag_cnt < SLAB_MAG_SIZE) {
+			c->mag[c->mag_cnt++] = obj;
+			stored = true;
+		}
+		intr_set_level (old_level);
+		if (!stored) {
+			slab_put (c, obj);
+			break;
+		}
+	}
+}
+
+// magazine의 절반을 slab에 돌려줌, c->lock을 잡은 상태로 호출
+static void
+slab_drain (struct slab_cache *c) {
+	enum intr_level old_level;
+	size_t i;
+
+	for (i = 0; i < SLAB_MAG_SIZE / 2; i++) {
+		void *obj = NULL;
+
+		old_level = intr_disable ();
+		if (c->mag_cnt > 0)
+			obj = c->mag[--c->mag_cnt];
+		intr_set_level (old_level);
+		if (obj == NULL)
+			break;
+		slab_put (c, obj);
+	}
+}
+
+// slab S의 IDX번째 object
+static void *
+slab_obj (struct slab *s, size_t idx) {
+	return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
@@ -6,6 +6,7 @@
 #include <string.h>
 #include "threads/flags.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
@@ -447,6 +448,7 @@ thread_exit (void) {
 	process_exit (); // P2
 
 #endif
+	malloc_thread_exit (); // 쓰레드별 malloc cache 반환 (P3-EX)
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
@@ -424,6 +424,7 @@ load (const char *file_name, struct intr_frame *if_) {
 #ifdef VM
 	// spt에 pml4를 연결 - vm.c supplemental_page_table_init() 참조
 	t->spt.pml4 = t->pml4;
+	t->spt.heap_start = t->spt.brk = NULL; // segment를 읽으며 설정
 #endif
 	process_activate (thread_current ());
 
@@ -503,6 +504,12 @@ load (const char *file_name, struct intr_frame *if_) {
 					if (!load_segment (file, file_page, (void *) mem_page,
 								read_bytes, zero_bytes, writable))
 						goto done;
+#ifdef VM
+					// heap은 가장 마지막 segment의 다음 페이지부터 시작
+					void *seg_end = (void *) (mem_page + read_bytes + zero_bytes);
+					if (seg_end > t->spt.heap_start)
+						t->spt.heap_start = t->spt.brk = seg_end;
+#endif
 				}
 				else
 					goto done;
@@ -762,23 +769,28 @@ lazy_load_segment (struct page *page, void *aux) {
 	ASSERT (page_read_bytes + page_zero_bytes == PGSIZE);
 	ASSERT (ofs % PGSIZE == 0);
 
-	file_seek (file, ofs);
 	/* Do calculate how to fill this page.
 		* We will read PAGE_READ_BYTES bytes from FILE
 		* and zero the final PAGE_ZERO_BYTES bytes. */
 
 	/* Get a page of memory. */
 	uint8_t *kpage = page->frame->kva;
-	uint8_t *upage = page->va;
 	ASSERT(kpage != NULL);
 
 	/* Load this page. */
-	if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes) {
+	// frame_list_lock 없이 불리므로 파일 위치를 공유하지 않도록 file_read_at 사용
+	if (file_read_at (file, kpage, page_read_bytes, ofs)
+		!= (int) page_read_bytes) {
 		printf("[DBG] lazy_load_segment(): file_read failed!\n");
 		return false;
 	}
 	memset (kpage + page_read_bytes, 0, page_zero_bytes);
 
+	if (!page->writable) {
+		// 같은 실행 파일을 실행하는 다른 프로세스가 이 페이지를 공유하도록 등록
+		vm_register_text_page(page, file, ofs, page_read_bytes);
+	}
+
 	free(upargs); // anon_initializer와 lazy_load_segment에서 사용이 모두 끝남
 	return true;
 }
@@ -813,9 +825,23 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+		if (!writable && vm_share_text_page(&thread_current()->spt, file,
+											ofs, upage, page_read_bytes)) {
+			// 다른 프로세스가 이미 불러온 read-only 페이지를 공유
+			goto next;
+		}
+		if (page_read_bytes == 0) {
+			// 파일에서 읽을 내용이 없는 bss 페이지: 처음 쓸 때까지 zero 페이지로 읽힘
+			if (!vm_alloc_anon_zero_page(upage, writable)) {
+				printf("[DBG] load_segment(): vm_alloc_anon_zero_page failed!\n");
+				return false;
+			}
+			goto next;
+		}
+
 		/* TODO: Set up aux to pass information to the lazy_load_segment. */
 		// void *aux = NULL;
-		struct uninit_page_args *upargs = malloc(sizeof(*upargs));
+		struct uninit_page_args *upargs = vm_alloc_page_args();
 		upargs->file = file;
 		upargs->ofs = ofs;
 		upargs->page_read_bytes = page_read_bytes;
@@ -829,6 +855,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 			return false;
 		}
 
+next:
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
@@ -848,7 +875,7 @@ setup_stack (struct intr_frame *if_) {
 	 * TODO: If success, set the rsp accordingly.
 	 * TODO: You should mark the page is stack. */
 	/* TODO: Your code goes here */
-	struct uninit_page_args *upargs = malloc(sizeof(*upargs));
+	struct uninit_page_args *upargs = vm_alloc_page_args();
 	upargs->is_stack = true;
 
 	if (!vm_alloc_page_with_initializer(VM_ANON, stack_bottom,
@@ -42,6 +42,12 @@ static unsigned tell(int fd);
 static void close(int fd);
 static void *mmap(void *addr, size_t length, int writable, int fd, off_t offset); // P3
 static void munmap (void *addr); // P3
+#ifdef VM
+static int msync(void *addr, size_t length, int flags); // P3-EX
+static int madvise(void *addr, size_t length, int advice); // P3-EX
+static void *sbrk(long increment); // P3-EX
+static bool is_user_range(const void *addr, size_t length); // P3-EX
+#endif
 static int dup2(int oldfd, int newfd); // P2-EX
 
 static bool fd_elem_fd_less(const struct list_elem *a,
@@ -186,6 +192,18 @@ syscall_handler (struct intr_frame *f) {
 		case SYS_UMOUNT:
 			printf("syscall_handler(): not implemented (rax = %d)\n", syscall_no);
 			break;
+		/* Extra for Project 3 */
+#ifdef VM
+		case SYS_MSYNC: /* Write back a memory mapping. */
+			ret = (uint64_t) msync(arg1, (size_t) arg2, (int) (uintptr_t) arg3);
+			break;
+		case SYS_MADVISE: /* Give advice about use of memory. */
+			ret = (uint64_t) madvise(arg1, (size_t) arg2, (int) (uintptr_t) arg3);
+			break;
+		case SYS_SBRK: /* Change the program break. */
+			ret = (uint64_t) sbrk((long) arg1);
+			break;
+#endif
 		default:
 			printf("syscall_handler(): unknown request (rax = %d)\n", syscall_no);
 	}
@@ -405,6 +423,11 @@ static void *mmap(void *addr, size_t length, int writable, int fd, off_t offset)
 		return NULL;
 	}
 
+	if (fd == MAP_ANONYMOUS) {
+		// 파일 없이 0으로 채워진 anonymous 메모리
+		return do_mmap(addr, length, writable, NULL, offset);
+	}
+
 	struct fd_elem *fde = get_fd_elem_in_list(fd);
 	if (fde == NULL) {
 		// fd에 해당하는 파일이 file_list에 없음
@@ -427,6 +450,45 @@ static void munmap (void *addr) {
 	do_munmap(addr);
 }
 
+// P3-EX
+#ifdef VM
+static int msync(void *addr, size_t length, int flags) {
+	if (length == 0) {
+		return 0;
+	}
+	if (!is_user_range(addr, length)) {
+		return -1;
+	}
+
+	return do_msync(addr, length, flags);
+}
+
+static int madvise(void *addr, size_t length, int advice) {
+	if (length == 0) {
+		return 0;
+	}
+	if (!is_user_range(addr, length)) {
+		return -1;
+	}
+
+	return do_madvise(addr, length, advice);
+}
+
+static void *sbrk(long increment) {
+	return do_sbrk(increment);
+}
+
+// [addr, addr + length)가 NULL이 아닌 사용자 영역 안에 있는지 확인 (length > 0)
+// 끝 주소가 overflow로 작아지는 경우도 거부
+static bool is_user_range(const void *addr, size_t length) {
+	uintptr_t start = (uintptr_t) addr;
+	uintptr_t last = start + length - 1;
+
+	return addr != NULL && last >= start
+		   && is_user_vaddr(addr) && is_user_vaddr((void *) last);
+}
+#endif
+
 
 // P2-EX
 static int dup2(int oldfd, int newfd) {
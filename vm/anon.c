@@ -23,6 +23,7 @@ static const struct page_operations anon_ops = {
 
 // swap table (P3)
 struct bitmap *swap_bitmap; // swap disk에 할당된 sector의 비트맵
+static struct lock swap_lock; // swap은 frame_list_lock 없이 수행되므로 별도 lock
 #define pg_to_sec(pg_no) (PGSIZE / DISK_SECTOR_SIZE * (pg_no))
 
 /* Initialize the data for anonymous pages */
@@ -31,6 +32,7 @@ vm_anon_init (void) {
 	swap_disk = disk_get(1, 1);
 	// swap disk에 저장할 수 있는 페이지 수와 같은 크기의 비트맵 생성
 	swap_bitmap = bitmap_create(disk_size(swap_disk) * DISK_SECTOR_SIZE/PGSIZE);
+	lock_init(&swap_lock);
 }
 
 /* Initialize the file mapping */
@@ -48,14 +50,15 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	// 옮겨적기
 	struct anon_page *anon_page = &page->anon;
 	anon_page->is_stack = is_stack;
+	anon_page->in_swap = false;
 
 	if (!init) {
 		// stack anon page는 vm_initializer가 없으므로 upargs를 여기서 free
 		free(upargs);
 	}
 
-	// 메모리 청소
-	memset(page->frame->kva, 0, PGSIZE);
+	// 메모리 청소는 vm_get_frame()에서 수행 (zero pool 또는 memset)
+	// lazy_load_segment()는 페이지 전체를 덮어쓰므로 청소 불필요
 
 	return true;
 }
@@ -64,7 +67,10 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	read_page_from_swap_disk(page);
+	lock_acquire(&swap_lock);
 	bitmap_set(swap_bitmap, page->anon.swap_pg_no, false); // 스왑 테이블 갱신
+	lock_release(&swap_lock);
+	page->anon.in_swap = false;
 
 	return true;
 }
@@ -73,24 +79,95 @@ anon_swap_in (struct page *page, void *kva) {
 static bool
 anon_swap_out (struct page *page) {
 	// 빈 스왑 페이지 찾기
+	lock_acquire(&swap_lock);
 	page->anon.swap_pg_no = bitmap_scan_and_flip(swap_bitmap, 0, 1, 0);
+	lock_release(&swap_lock);
 	write_page_to_swap_disk(page);
+	page->anon.in_swap = true;
 
 	return true;
 }
 
+/* Do the sbrk */
+// program break를 INCREMENT만큼 옮기고 이전 break를 반환, 실패 시 (void *) -1
+// 영역만 늘리고, 페이지는 처음 접근할 때 heap_alloc_page()로 만듦
+void *
+do_sbrk (long increment) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	void *old_brk = spt->brk;
+	void *new_brk = old_brk + increment;
+
+	if (old_brk == NULL || new_brk < spt->heap_start
+		|| !is_user_vaddr(new_brk)
+		|| (increment > 0 && new_brk < old_brk)) { // overflow
+		return (void *) -1;
+	}
+
+	void *old_end = pg_round_up(old_brk);
+	void *new_end = pg_round_up(new_brk);
+	void *va;
+
+	if (new_end > old_end) {
+		// stack은 STACK_LIM 위, 실행 파일의 segment는 heap_start 아래에 있으므로
+		// 늘어난 영역과 겹칠 수 있는 것은 (아직 접근하지 않은 페이지를 포함한) mmap 영역뿐
+		if (new_end > (void *) STACK_LIM
+			|| mmap_range_overlaps(spt, old_end, new_end - old_end))
+			return (void *) -1;
+	} else if (new_end < old_end) {
+		// 줄어든 영역에서 만들어진 페이지 제거 (물리 메모리, swap 공간도 반환됨)
+		struct tlb_gather tlb;
+		lock_acquire(&frame_list_lock);
+		bool started = spt_tlb_gather_begin(spt, &tlb);
+		for (va = new_end; va < old_end; va += PGSIZE) {
+			struct page *page = spt_find_page(spt, va);
+			if (page)
+				spt_remove_page(spt, page);
+		}
+		spt_tlb_gather_end(spt, started);
+		lock_release(&frame_list_lock);
+	}
+
+	spt->brk = new_brk;
+	return old_brk;
+}
+
+// va가 heap 영역 안이지만 아직 페이지가 없다면 spt에 만들어 넣음
+// 새로 만들었다면 true, heap 영역이 아니면 false 반환
+bool
+heap_alloc_page (struct supplemental_page_table *spt, void *va) {
+	if (!heap_range_overlaps(spt, va, 1))
+		return false;
+	return vm_alloc_anon_zero_page(pg_round_down(va), true);
+}
+
+// [addr, addr + length)가 heap 영역 [heap_start, brk를 올림한 페이지)와 겹치는지 여부
+bool
+heap_range_overlaps (struct supplemental_page_table *spt,
+					 void *addr, size_t length) {
+	return addr < pg_round_up(spt->brk) && spt->heap_start < addr + length;
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->in_swap) {
+		// swap out된 상태로 삭제됨: swap 공간 반환
+		lock_acquire(&swap_lock);
+		bitmap_set(swap_bitmap, anon_page->swap_pg_no, false);
+		lock_release(&swap_lock);
+	}
 }
 
 // Swap in/out helpers
+// kswapd처럼 페이지를 소유하지 않은 쓰레드도 swap할 수 있도록
+// user 주소 (page->va) 대신 프레임의 kva로 읽고 씀
 static void write_page_to_swap_disk(struct page *page) {
 	ASSERT(page->frame != NULL);
 
 	size_t sec_no = pg_to_sec(page->anon.swap_pg_no);
-	void *addr = page->va;
+	void *addr = page->frame->kva;
 	for (size_t sec_idx = 0; sec_idx < PGSIZE / DISK_SECTOR_SIZE; sec_idx++) {
 		// 페이지 크기만큼 swap disk 섹터에 쓰기
 		disk_write(swap_disk, sec_no + sec_idx,
@@ -102,7 +179,7 @@ static void read_page_from_swap_disk(struct page *page) {
 	ASSERT(page->frame != NULL);
 
 	size_t sec_no = pg_to_sec(page->anon.swap_pg_no);
-	void *addr = page->va;
+	void *addr = page->frame->kva;
 	for (size_t sec_idx = 0; sec_idx < PGSIZE / DISK_SECTOR_SIZE; sec_idx++) {
 		// 페이지 크기만큼 swap disk 섹터에 쓰기
 		disk_read(swap_disk, sec_no + sec_idx,
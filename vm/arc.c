@@ -0,0 +1,161 @@
+/* arc.c: ARC eviction policy (P3-EX).
+ * 하드웨어는 accessed bit만 제공하므로 ARC의 LRU 리스트 대신
+ * clock을 사용하는 CAR (Clock with Adaptive Replacement)로 구현.
+ * T1: 한 번 사용된 페이지, T2: 두 번 이상 사용된 페이지,
+ * B1/B2: T1/T2에서 evict된 페이지의 기록 (ghost).
+ * ghost hit에 따라 T1의 목표 크기 p를 조절하므로, sequential scan은 T1에만
+ * 머물다가 빠져나가고 T2의 working set은 유지됨. */
+
+#include "vm/vm.h"
+#include "vm/evict.h"
+
+#define ARC_T1 1 // frame->evict_state
+#define ARC_T2 2
+#define ARC_B1 1 // page->ghost
+#define ARC_B2 2
+
+static struct list arc_t1, arc_t2, arc_b1, arc_b2;
+static size_t arc_t1_cnt, arc_t2_cnt, arc_b1_cnt, arc_b2_cnt;
+static size_t arc_capacity; // c
+static size_t arc_p; // T1의 목표 크기
+
+static void arc_push_ghost (struct page *page, uint8_t which);
+static void arc_drop_ghost (struct list *ghost_list, size_t *cnt);
+
+static void arc_init (size_t capacity) {
+	list_init(&arc_t1);
+	list_init(&arc_t2);
+	list_init(&arc_b1);
+	list_init(&arc_b2);
+	arc_t1_cnt = arc_t2_cnt = arc_b1_cnt = arc_b2_cnt = 0;
+	arc_capacity = capacity;
+	arc_p = 0;
+}
+
+static void arc_insert (struct frame *frame) {
+	struct page *page = frame->page;
+	frame_mark_fresh(frame);
+
+	if (page->ghost == ARC_B1) {
+		// B1 hit: T1이 너무 작았음, p를 늘림
+		size_t delta = arc_b2_cnt > arc_b1_cnt ? arc_b2_cnt / arc_b1_cnt : 1;
+		arc_p = arc_p + delta < arc_capacity ? arc_p + delta : arc_capacity;
+		list_remove(&page->ghost_elem);
+		arc_b1_cnt--;
+	} else if (page->ghost == ARC_B2) {
+		// B2 hit: T2가 너무 작았음, p를 줄임
+		size_t delta = arc_b1_cnt > arc_b2_cnt ? arc_b1_cnt / arc_b2_cnt : 1;
+		arc_p = arc_p > delta ? arc_p - delta : 0;
+		list_remove(&page->ghost_elem);
+		arc_b2_cnt--;
+	} else {
+		// 처음 보는 페이지는 T1에 삽입
+		frame->evict_state = ARC_T1;
+		list_push_back(&arc_t1, &frame->elem);
+		arc_t1_cnt++;
+		return;
+	}
+
+	// ghost hit한 페이지는 재사용되었으므로 T2에 삽입
+	page->ghost = 0;
+	frame->evict_state = ARC_T2;
+	list_push_back(&arc_t2, &frame->elem);
+	arc_t2_cnt++;
+}
+
+static struct frame *arc_victim (void) {
+	ASSERT(arc_t1_cnt + arc_t2_cnt > 0);
+
+	struct frame *frame;
+	for (;;) {
+		if (arc_t1_cnt > 0 &&
+			(arc_t1_cnt >= (arc_p > 0 ? arc_p : 1) || arc_t2_cnt == 0)) {
+			// T1의 clock hand
+			frame = list_entry(list_pop_front(&arc_t1), struct frame, elem);
+			if (!frame_referenced(frame)) {
+				arc_t1_cnt--;
+				arc_push_ghost(frame->page, ARC_B1);
+				break;
+			}
+			// 다시 사용됨: T2로 이동
+			arc_t1_cnt--;
+			frame->evict_state = ARC_T2;
+			list_push_back(&arc_t2, &frame->elem);
+			arc_t2_cnt++;
+		} else {
+			// T2의 clock hand
+			frame = list_entry(list_pop_front(&arc_t2), struct frame, elem);
+			if (!frame_referenced(frame)) {
+				arc_t2_cnt--;
+				arc_push_ghost(frame->page, ARC_B2);
+				break;
+			}
+			list_push_back(&arc_t2, &frame->elem);
+		}
+	}
+
+	frame_unmark_fresh(frame);
+	return frame;
+}
+
+// evict된 페이지를 ghost 리스트에 기록하고, 기록의 전체 크기를 c 안으로 유지
+static void arc_push_ghost (struct page *page, uint8_t which) {
+	page->ghost = which;
+	if (which == ARC_B1) {
+		list_push_back(&arc_b1, &page->ghost_elem);
+		arc_b1_cnt++;
+	} else {
+		list_push_back(&arc_b2, &page->ghost_elem);
+		arc_b2_cnt++;
+	}
+
+	// |T1| + |B1| <= c, |T1| + |T2| + |B1| + |B2| <= 2c
+	while (arc_t1_cnt + arc_b1_cnt > arc_capacity && arc_b1_cnt > 0)
+		arc_drop_ghost(&arc_b1, &arc_b1_cnt);
+	while (arc_t1_cnt + arc_t2_cnt + arc_b1_cnt + arc_b2_cnt > 2 * arc_capacity
+		   && arc_b2_cnt > 0)
+		arc_drop_ghost(&arc_b2, &arc_b2_cnt);
+}
+
+// 가장 오래된 ghost를 버림
+static void arc_drop_ghost (struct list *ghost_list, size_t *cnt) {
+	struct page *page = list_entry(list_pop_front(ghost_list),
+								   struct page, ghost_elem);
+	page->ghost = 0;
+	(*cnt)--;
+}
+
+static void arc_remove (struct frame *frame) {
+	frame_unmark_fresh(frame);
+	list_remove(&frame->elem);
+	if (frame->evict_state == ARC_T1)
+		arc_t1_cnt--;
+	else
+		arc_t2_cnt--;
+}
+
+static bool arc_empty (void) {
+	return arc_t1_cnt + arc_t2_cnt == 0;
+}
+
+static void arc_forget (struct page *page) {
+	if (page->ghost == ARC_B1) {
+		list_remove(&page->ghost_elem);
+		arc_b1_cnt--;
+	} else if (page->ghost == ARC_B2) {
+		list_remove(&page->ghost_elem);
+		arc_b2_cnt--;
+	}
+	page->ghost = 0;
+}
+
+const struct evict_policy evict_arc = {
+	.name = "arc",
+	.init = arc_init,
+	.insert = arc_insert,
+	.touch = frame_mark_accessed,
+	.victim = arc_victim,
+	.remove = arc_remove,
+	.empty = arc_empty,
+	.forget = arc_forget,
+};
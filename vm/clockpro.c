@@ -0,0 +1,171 @@
+/* clockpro.c: CLOCK-Pro eviction policy (P3-EX).
+ * 재사용 거리가 짧은 hot 페이지와 긴 cold 페이지를 구분하여,
+ * 한 번만 읽고 지나가는 큰 sequential scan이 hot 페이지를 밀어내지 못하게 함.
+ * 원래 알고리즘은 하나의 clock에서 세 개의 hand를 사용하지만,
+ * 여기서는 hot/cold/non-resident를 각각의 리스트로 나누어 근사함. */
+
+#include "vm/vm.h"
+#include "vm/evict.h"
+
+#define CP_COLD 1 // frame->evict_state
+#define CP_HOT 2
+#define CP_TEST 4 // cold 페이지가 test period 중임 (재사용 거리 측정중)
+#define CP_GHOST 1 // page->ghost: test period 중에 evict된 non-resident 페이지
+
+static struct list cp_hot, cp_cold, cp_ghost;
+static size_t cp_hot_cnt, cp_cold_cnt, cp_ghost_cnt;
+static size_t cp_capacity;
+static size_t cp_cold_target; // 상주 cold 페이지 목표 수 (m_c), 적응적으로 조절
+
+static void cp_run_hot_hand (void);
+static void cp_expire_ghost (void);
+
+static void cp_init (size_t capacity) {
+	list_init(&cp_hot);
+	list_init(&cp_cold);
+	list_init(&cp_ghost);
+	cp_hot_cnt = cp_cold_cnt = cp_ghost_cnt = 0;
+	cp_capacity = capacity;
+	cp_cold_target = capacity / 8 > 0 ? capacity / 8 : 1;
+}
+
+static void cp_insert (struct frame *frame) {
+	struct page *page = frame->page;
+	frame_mark_fresh(frame);
+
+	if (page->ghost == CP_GHOST) {
+		// test period 중에 다시 fault됨: hot 페이지보다 재사용 거리가 짧음
+		// cold 영역이 부족했으므로 목표를 늘리고 hot으로 삽입
+		list_remove(&page->ghost_elem);
+		cp_ghost_cnt--;
+		page->ghost = 0;
+		if (cp_cold_target + 1 < cp_capacity)
+			cp_cold_target++;
+
+		frame->evict_state = CP_HOT;
+		list_push_back(&cp_hot, &frame->elem);
+		cp_hot_cnt++;
+	} else {
+		// 새 페이지는 test period 상태의 cold로 시작
+		frame->evict_state = CP_COLD | CP_TEST;
+		list_push_back(&cp_cold, &frame->elem);
+		cp_cold_cnt++;
+	}
+}
+
+// cold hand: accessed가 아닌 cold 페이지를 찾아 evict
+static struct frame *cp_victim (void) {
+	ASSERT(cp_hot_cnt + cp_cold_cnt > 0);
+
+	struct frame *frame;
+	for (;;) {
+		if (cp_cold_cnt == 0) {
+			// cold 페이지가 없으면 hot 하나를 cold로 강등
+			cp_run_hot_hand();
+			continue;
+		}
+
+		frame = list_entry(list_pop_front(&cp_cold), struct frame, elem);
+
+		if (!frame_referenced(frame)) {
+			cp_cold_cnt--;
+			break;
+		}
+
+		if (frame->evict_state & CP_TEST) {
+			// test period 중에 재사용됨: hot으로 승격
+			cp_cold_cnt--;
+			frame->evict_state = CP_HOT;
+			list_push_back(&cp_hot, &frame->elem);
+			cp_hot_cnt++;
+
+			// hot이 목표치 (상주 프레임 - m_c)를 넘으면 hot hand 실행
+			while (cp_hot_cnt > 0 && cp_cold_cnt < cp_cold_target)
+				cp_run_hot_hand();
+		} else {
+			// test period 시작 후 다시 한 바퀴 기회
+			frame->evict_state |= CP_TEST;
+			list_push_back(&cp_cold, &frame->elem);
+		}
+	}
+
+	if (frame->evict_state & CP_TEST) {
+		// test period 중에 evict: non-resident로 기억해두었다가
+		// 그 사이에 다시 fault되면 hot으로 삽입
+		struct page *page = frame->page;
+		page->ghost = CP_GHOST;
+		list_push_back(&cp_ghost, &page->ghost_elem);
+		cp_ghost_cnt++;
+		while (cp_ghost_cnt > cp_capacity)
+			cp_expire_ghost();
+	}
+	frame_unmark_fresh(frame);
+	return frame;
+}
+
+// hot hand: accessed가 아닌 hot 페이지를 cold로 강등
+static void cp_run_hot_hand (void) {
+	ASSERT(cp_hot_cnt > 0);
+
+	struct frame *frame;
+	for (;;) {
+		frame = list_entry(list_pop_front(&cp_hot), struct frame, elem);
+		if (!frame_referenced(frame))
+			break;
+		list_push_back(&cp_hot, &frame->elem);
+	}
+	cp_hot_cnt--;
+
+	frame->evict_state = CP_COLD; // test period 없이 cold로
+	list_push_back(&cp_cold, &frame->elem);
+	cp_cold_cnt++;
+
+	// hot hand가 지나가면 가장 오래된 test period가 끝남
+	cp_expire_ghost();
+}
+
+// 가장 오래된 non-resident 페이지의 test period를 종료
+// 재사용되지 않고 끝났으므로 cold 영역 목표를 줄임
+static void cp_expire_ghost (void) {
+	if (cp_ghost_cnt == 0)
+		return;
+
+	struct page *page = list_entry(list_pop_front(&cp_ghost),
+								   struct page, ghost_elem);
+	page->ghost = 0;
+	cp_ghost_cnt--;
+	if (cp_cold_target > 1)
+		cp_cold_target--;
+}
+
+static void cp_remove (struct frame *frame) {
+	frame_unmark_fresh(frame);
+	list_remove(&frame->elem);
+	if (frame->evict_state & CP_HOT)
+		cp_hot_cnt--;
+	else
+		cp_cold_cnt--;
+}
+
+static bool cp_empty (void) {
+	return cp_hot_cnt + cp_cold_cnt == 0;
+}
+
+static void cp_forget (struct page *page) {
+	if (page->ghost == CP_GHOST) {
+		list_remove(&page->ghost_elem);
+		cp_ghost_cnt--;
+		page->ghost = 0;
+	}
+}
+
+const struct evict_policy evict_clockpro = {
+	.name = "clockpro",
+	.init = cp_init,
+	.insert = cp_insert,
+	.touch = frame_mark_accessed,
+	.victim = cp_victim,
+	.remove = cp_remove,
+	.empty = cp_empty,
+	.forget = cp_forget,
+};
@@ -0,0 +1,395 @@
+/* evict.c: Pluggable eviction policies for user frames (P3-EX).
+ * FIFO, Lenient LRU, Clock, 2Q are implemented here,
+ * CLOCK-Pro and ARC (CAR) live in clockpro.c and arc.c. */
+
+#include "vm/vm.h"
+#include "vm/evict.h"
+#include <stdio.h>
+
+// 선택 가능한 정책 목록, 첫 번째 항목이 기본값
+static const struct evict_policy *const policies[] = {
+	&evict_clock,
+	&evict_fifo,
+	&evict_llru,
+	&evict_2q,
+	&evict_clockpro,
+	&evict_arc,
+};
+#define POLICY_CNT (sizeof policies / sizeof *policies)
+
+const struct evict_policy *evict_policy = &evict_clock;
+
+static struct frame *fresh_frame; // 가장 최근에 삽입된 프레임 (frame_mark_fresh)
+
+// 이름으로 정책을 찾아 반환, 없으면 NULL
+const struct evict_policy *evict_policy_find (const char *name) {
+	for (size_t i = 0; i < POLICY_CNT; i++) {
+		if (!strcmp(policies[i]->name, name))
+			return policies[i];
+	}
+	return NULL;
+}
+
+// 커널 옵션 -evict=NAME 처리, vm_init() 이전에 호출되어야 함
+bool evict_policy_select (const char *name) {
+	const struct evict_policy *policy = evict_policy_find(name);
+	if (!policy)
+		return false;
+
+	evict_policy = policy;
+	return true;
+}
+
+// 현재 정책의 자료구조를 초기화
+void evict_policy_init (size_t capacity) {
+	fresh_frame = NULL;
+	evict_policy->init(capacity);
+}
+
+// usage()에서 사용
+void evict_policy_print_names (void) {
+	for (size_t i = 0; i < POLICY_CNT; i++)
+		printf("%s%s", i ? ", " : "", policies[i]->name);
+}
+
+// =========================== [Accessed helpers] ==============================
+// '구독'중인 모든 spt의 pml4와 커널 pml4의 accessed bit을 확인하고 0으로
+// spt_elem에 캐시된 pte를 사용하므로 page table을 다시 walk하지 않음
+bool frame_collect_accessed (struct frame *frame) {
+	struct page *page = frame->page;
+	bool accessed = false;
+
+	struct list *share_list = &page->share_list;
+	struct list_elem *e;
+	struct spt_elem *se;
+	for (e = list_begin(share_list);
+		 e != list_end(share_list); e = list_next(e)) {
+		se = list_entry(e, struct spt_elem, elem);
+
+		if (se->pte && (*se->pte & PTE_A)) {
+			accessed = true;
+			pml4_pte_set_accessed(se->spt->pml4, se->pte, page->va, false);
+		}
+	}
+
+	// 커널 pml4의 accessed bit 확인
+	if ((*frame->kpte) & PTE_A) {
+		accessed = true;
+		pml4_pte_set_accessed(base_pml4, frame->kpte, frame->kva, false);
+	}
+
+	return accessed;
+}
+
+// aging pass (vm_age_frames)가 모아둔 bit과 현재 accessed bit을 확인하고 0으로
+bool frame_test_and_clear_accessed (struct frame *frame) {
+	bool accessed = frame_collect_accessed(frame) || frame->referenced;
+	frame->referenced = false;
+	return accessed;
+}
+
+// 새로 삽입된 프레임을 fresh로 표시
+// 직전에 삽입된 프레임은 fault를 일으킨 access가 이미 끝났으므로 accessed bit을
+// 지워서, 이후에 켜지는 bit만 재사용으로 보이게 함
+// 한 번만 읽고 지나가는 페이지 (sequential scan)를 자주 쓰는 페이지로 오인하지 않음
+void frame_mark_fresh (struct frame *frame) {
+	if (fresh_frame && fresh_frame->fresh) {
+		frame_test_and_clear_accessed(fresh_frame);
+		fresh_frame->fresh = false;
+	}
+	frame->fresh = true;
+	fresh_frame = frame;
+}
+
+// 정책의 관리 대상에서 빠지는 프레임 (victim, remove)에 대해 호출
+void frame_unmark_fresh (struct frame *frame) {
+	if (fresh_frame == frame)
+		fresh_frame = NULL;
+}
+
+// frame_test_and_clear_accessed()와 같지만, fresh 프레임의 bit은
+// fault를 일으킨 access의 것일 수 있으므로 무시
+bool frame_referenced (struct frame *frame) {
+	bool accessed = frame_test_and_clear_accessed(frame);
+
+	if (frame->fresh) {
+		frame->fresh = false;
+		return false;
+	}
+	return accessed;
+}
+
+// touch callback 공용 구현: 다음 확인 때 referenced로 보이도록 표시
+void frame_mark_accessed (struct frame *frame) {
+	frame->fresh = false;
+	pml4_pte_set_accessed(base_pml4, frame->kpte, frame->kva, true);
+}
+
+// ================================ [FIFO] =====================================
+// frame_list에 먼저 삽입된 (가장 오래된) 프레임 선택
+static struct list fifo_list;
+
+static void fifo_init (size_t capacity UNUSED) {
+	list_init(&fifo_list);
+}
+
+static void fifo_insert (struct frame *frame) {
+	list_push_back(&fifo_list, &frame->elem);
+}
+
+static struct frame *fifo_victim (void) {
+	ASSERT(!list_empty(&fifo_list));
+	return list_entry(list_pop_front(&fifo_list), struct frame, elem);
+}
+
+static void fifo_remove (struct frame *frame) {
+	list_remove(&frame->elem);
+}
+
+static bool fifo_empty (void) {
+	return list_empty(&fifo_list);
+}
+
+const struct evict_policy evict_fifo = {
+	.name = "fifo",
+	.init = fifo_init,
+	.insert = fifo_insert,
+	.touch = NULL,
+	.victim = fifo_victim,
+	.remove = fifo_remove,
+	.empty = fifo_empty,
+	.forget = NULL,
+};
+
+// ============================ [Lenient LRU] ==================================
+// 마지막 eviction 이후 access되지 않은 프레임 중 FIFO
+static struct list llru_list;
+static struct frame llru_nil; // sentinel
+
+static void llru_init (size_t capacity UNUSED) {
+	list_init(&llru_list);
+	list_push_back(&llru_list, &llru_nil.elem);
+}
+
+static void llru_insert (struct frame *frame) {
+	list_push_back(&llru_list, &frame->elem);
+}
+
+// frame_list에서 accessed 비트가 표시된 페이지들을 뒤로 밀고 accessed를 제거
+static void push_accessed_frame_back (void) {
+	struct list_elem *nil_elem = &llru_nil.elem; // sentinel
+
+	list_remove(nil_elem);
+	list_push_back(&llru_list, nil_elem); // sentinel을 맨 뒤로 보내기
+
+	struct list_elem *e;
+	struct frame *frame;
+	for (e = list_begin(&llru_list); e != nil_elem; e = list_next(e)) {
+		frame = list_entry(e, struct frame, elem);
+
+		// accessed인 프레임은 맨 뒤로 보냄
+		if (frame_test_and_clear_accessed(frame)) {
+			e = list_prev(e);
+			list_remove(&frame->elem);
+			list_push_back(&llru_list, &frame->elem);
+		}
+	}
+
+	list_remove(nil_elem);
+	list_push_front(&llru_list, nil_elem); // sentinel 다시 맨 앞으로
+}
+
+static struct frame *llru_victim (void) {
+	ASSERT(list_next(&llru_nil.elem) != list_end(&llru_list));
+
+	push_accessed_frame_back();
+	struct frame *victim = list_entry(list_next(&llru_nil.elem),
+									  struct frame, elem);
+	list_remove(&victim->elem);
+	return victim;
+}
+
+static void llru_remove (struct frame *frame) {
+	list_remove(&frame->elem);
+}
+
+static bool llru_empty (void) {
+	return list_next(&llru_nil.elem) == list_end(&llru_list);
+}
+
+const struct evict_policy evict_llru = {
+	.name = "llru",
+	.init = llru_init,
+	.insert = llru_insert,
+	.touch = frame_mark_accessed,
+	.victim = llru_victim,
+	.remove = llru_remove,
+	.empty = llru_empty,
+	.forget = NULL,
+};
+
+// ================================ [Clock] ====================================
+// clock algorithm (second wind): 기존 list 구조체 대신 순환 리스트로 구현
+static struct frame clock_nil; // sentinel이자 clock hand의 위치
+
+static void clock_init (size_t capacity UNUSED) {
+	clock_nil.elem.next = &clock_nil.elem; // 순환 리스트
+	clock_nil.elem.prev = &clock_nil.elem;
+}
+
+static void clock_insert (struct frame *frame) {
+	// sentinel 직전에 삽입
+	list_insert(&clock_nil.elem, &frame->elem);
+}
+
+// accessed bit이 0인 첫 번째 프레임을 탐색, 1인 프레임은 0으로 만들고 스킵
+static struct frame *clock_victim (void) {
+	struct list_elem *nil_elem = &clock_nil.elem; // sentinel
+	ASSERT(list_next(nil_elem) != nil_elem);
+
+	struct list_elem *e = list_next(nil_elem);
+	list_remove(nil_elem); // sentinel 뽑아놓기
+
+	struct frame *frame;
+	for (;;) {
+		frame = list_entry(e, struct frame, elem);
+
+		// accessed 0인 경우 evict할 페이지로 선택
+		if (!frame_test_and_clear_accessed(frame))
+			break;
+		e = list_next(e);
+	}
+
+	list_insert(e, nil_elem); // sentinel을 탐색 지점으로 이동
+	list_remove(&frame->elem);
+	return frame;
+}
+
+static void clock_remove (struct frame *frame) {
+	list_remove(&frame->elem);
+}
+
+static bool clock_empty (void) {
+	return list_next(&clock_nil.elem) == &clock_nil.elem;
+}
+
+const struct evict_policy evict_clock = {
+	.name = "clock",
+	.init = clock_init,
+	.insert = clock_insert,
+	.touch = frame_mark_accessed,
+	.victim = clock_victim,
+	.remove = clock_remove,
+	.empty = clock_empty,
+	.forget = NULL,
+};
+
+// ================================= [2Q] ======================================
+// 새 페이지는 A1in (FIFO)에 넣고, A1in에서 쫓겨난 페이지를 A1out (ghost)에 기억
+// A1out에 있는 동안 다시 fault된 페이지만 Am (clock)에 들어감
+#define Q2_A1IN 1 // frame->evict_state
+#define Q2_AM 2
+#define Q2_A1OUT 1 // page->ghost
+
+static struct list q2_a1in, q2_am, q2_a1out;
+static size_t q2_a1in_cnt, q2_am_cnt, q2_a1out_cnt;
+static size_t q2_capacity;
+
+static void q2_init (size_t capacity) {
+	list_init(&q2_a1in);
+	list_init(&q2_am);
+	list_init(&q2_a1out);
+	q2_a1in_cnt = q2_am_cnt = q2_a1out_cnt = 0;
+	q2_capacity = capacity;
+}
+
+static void q2_insert (struct frame *frame) {
+	struct page *page = frame->page;
+	frame_mark_fresh(frame);
+
+	if (page->ghost == Q2_A1OUT) {
+		// A1out에 기억된 페이지: 재사용되었으므로 Am으로
+		list_remove(&page->ghost_elem);
+		q2_a1out_cnt--;
+		page->ghost = 0;
+
+		frame->evict_state = Q2_AM;
+		list_push_back(&q2_am, &frame->elem);
+		q2_am_cnt++;
+	} else {
+		frame->evict_state = Q2_A1IN;
+		list_push_back(&q2_a1in, &frame->elem);
+		q2_a1in_cnt++;
+	}
+}
+
+static struct frame *q2_victim (void) {
+	ASSERT(q2_a1in_cnt + q2_am_cnt > 0);
+
+	// A1in은 상주 프레임의 1/4, A1out은 전체 용량의 1/2까지 유지
+	size_t kin = (q2_a1in_cnt + q2_am_cnt) / 4;
+	size_t kout = q2_capacity / 2;
+	struct frame *frame;
+
+	if (q2_a1in_cnt > 0 && (q2_a1in_cnt > kin || q2_am_cnt == 0)) {
+		frame = list_entry(list_pop_front(&q2_a1in), struct frame, elem);
+		q2_a1in_cnt--;
+
+		// A1out에 기억, 넘치면 가장 오래된 ghost를 버림
+		struct page *page = frame->page;
+		page->ghost = Q2_A1OUT;
+		list_push_back(&q2_a1out, &page->ghost_elem);
+		q2_a1out_cnt++;
+		while (q2_a1out_cnt > kout && q2_a1out_cnt > 0) {
+			struct page *old = list_entry(list_pop_front(&q2_a1out),
+										  struct page, ghost_elem);
+			old->ghost = 0;
+			q2_a1out_cnt--;
+		}
+		frame_unmark_fresh(frame);
+		return frame;
+	}
+
+	// Am에서 clock으로 선택
+	for (;;) {
+		frame = list_entry(list_pop_front(&q2_am), struct frame, elem);
+		if (!frame_referenced(frame))
+			break;
+		list_push_back(&q2_am, &frame->elem);
+	}
+	q2_am_cnt--;
+	frame_unmark_fresh(frame);
+	return frame;
+}
+
+static void q2_remove (struct frame *frame) {
+	frame_unmark_fresh(frame);
+	list_remove(&frame->elem);
+	if (frame->evict_state == Q2_A1IN)
+		q2_a1in_cnt--;
+	else
+		q2_am_cnt--;
+}
+
+static bool q2_empty (void) {
+	return q2_a1in_cnt + q2_am_cnt == 0;
+}
+
+static void q2_forget (struct page *page) {
+	if (page->ghost == Q2_A1OUT) {
+		list_remove(&page->ghost_elem);
+		q2_a1out_cnt--;
+		page->ghost = 0;
+	}
+}
+
+const struct evict_policy evict_2q = {
+	.name = "2q",
+	.init = q2_init,
+	.insert = q2_insert,
+	.touch = frame_mark_accessed,
+	.victim = q2_victim,
+	.remove = q2_remove,
+	.empty = q2_empty,
+	.forget = q2_forget,
+};
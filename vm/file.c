@@ -1,6 +1,13 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include <syscall-nr.h> // MS_*, MADV_*
+#include "devices/disk.h" // DISK_SECTOR_SIZE
+#include "filesys/journal.h" // write-back (P3-EX)
+
+#define FILE_PAGE_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+#define READAHEAD_NORMAL 2 // sequential 접근이 감지되면 미리 읽을 페이지 수
+#define READAHEAD_SEQ 8 // MADV_SEQUENTIAL 영역에서 미리 읽을 페이지 수
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -17,6 +24,14 @@ static const struct page_operations file_ops = {
 // P3
 static bool file_page_lazy_load(struct page *page, void *aux);
 static struct file *get_file_from_hash(struct hash *h, void *addr);
+static struct file *get_page_file(struct page *page);
+static bool range_is_mapped(void *addr, size_t length);
+static bool mmap_list_less(const struct list_elem *a,
+						   const struct list_elem *b, void *aux UNUSED);
+static void *mmap_end(struct mmap_elem *me);
+static void hash_sectors(struct page *page, void *kva);
+static void write_back_range(struct file *file, struct file_page *file_page,
+							 uint8_t *kva, uint32_t start, uint32_t end);
 
 /* The initializer of file vm */
 void
@@ -43,37 +58,74 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	file_page->ofs = ofs;
 	file_page->page_read_bytes = page_read_bytes;
 	file_page->page_zero_bytes = page_zero_bytes;
+	// read-only 매핑은 write-back하지 않으므로 hash도 필요 없음
+	// 할당에 실패하면 write-back 시 페이지 전체를 씀
+	file_page->sector_hash = page->writable ?
+		malloc(FILE_PAGE_SECTORS * sizeof(uint64_t)) : NULL;
 
 	return true;
 }
 
 // 필요 시 파일에 write-back
+// dirty bit은 페이지 단위이므로, 섹터별 hash를 비교하여 바뀐 섹터만 씀
+// hash가 같은 섹터는 충돌일 수 있으므로 파일의 현재 내용과 byte 단위로 비교해 확인함
+// (페이지마다 4 KiB의 사본을 두지 않고, 그런 섹터가 있을 때만 파일을 한 번 읽음)
 void file_backed_write_back(struct page *page, struct file *file) {
-	bool u_dirty = pml4_is_dirty(thread_current()->pml4, page->va);
-	bool k_dirty = (*page->frame->kpte) & PTE_D;
-	if (u_dirty || k_dirty) {
-		// user pml4 또는, kernel pml4의 pte가 dirty라면 write-back
-		file_seek(file, page->file.ofs);
-
-		// destory는 pml4 삭제 후 호출되므로 kva로 삭제
-		int bytes_written = file_write(file, page->frame->kva,
-										page->file.page_read_bytes);
-
-		if (bytes_written != page->file.page_read_bytes) {
-			printf("[DBG] file_backed_write_back(): error while writting back");
+	if (!vm_page_is_dirty(page))
+		return;
+
+	// 공유중인 pml4 또는, kernel pml4의 pte가 dirty라면 write-back
+	// destory는 pml4 삭제 후 호출되므로 kva로 삭제
+	// kswapd와 파일 위치를 공유하지 않도록 file_write_at 사용
+	struct file_page *file_page = &page->file;
+	uint8_t *kva = page->frame->kva;
+	uint32_t read_bytes = file_page->page_read_bytes;
+	uint32_t run_start = 0, run_end = 0; // 연속으로 바뀐 섹터 구간 [start, end)
+	uint8_t *copy = NULL; // 파일의 현재 내용
+	off_t copy_bytes = 0;
+
+	if (!file_page->sector_hash) {
+		// 섹터별 hash가 없음: 페이지 전체를 씀
+		write_back_range(file, file_page, kva, 0, read_bytes);
+		return;
+	}
+
+	for (uint32_t start = 0; start < read_bytes; start += DISK_SECTOR_SIZE) {
+		uint32_t len = read_bytes - start < DISK_SECTOR_SIZE ?
+					   read_bytes - start : DISK_SECTOR_SIZE;
+		uint64_t hash = hash_bytes(kva + start, len);
+		size_t sec_idx = start / DISK_SECTOR_SIZE;
+
+		if (hash == file_page->sector_hash[sec_idx]) {
+			// 읽지 못하면 바뀐 것으로 보고 씀
+			if (copy == NULL && (copy = palloc_get_page(0)) != NULL)
+				copy_bytes = file_read_at(file, copy, read_bytes, file_page->ofs);
+			if (copy != NULL && (off_t) (start + len) <= copy_bytes
+				&& !memcmp(copy + start, kva + start, len))
+				continue;
 		}
+		file_page->sector_hash[sec_idx] = hash;
+
+		if (run_end != start) {
+			// 이전 구간과 이어지지 않음: 이전 구간을 먼저 씀
+			write_back_range(file, file_page, kva, run_start, run_end);
+			run_start = start;
+		}
+		run_end = start + len;
 	}
+	write_back_range(file, file_page, kva, run_start, run_end);
+	if (copy != NULL)
+		palloc_free_page(copy);
 }
 
 /* Swap in the page by read contents from the file. */
 // file_page_lazy_load()와 거의 동일
 static bool
-file_backed_swap_in (struct page *page, void *kva UNUSED) {
+file_backed_swap_in (struct page *page, void *kva) {
 	struct file_page *file_page = &page->file;
 
-	// // mmap_hash에서 page에 해당되는 파일 구조체 가져오기
-	struct file *file = get_file_from_hash(&thread_current()->spt.mmap_hash,
-											file_page->addr);
+	// mmap_hash에서 page에 해당되는 파일 구조체 가져오기
+	struct file *file = get_page_file(page);
 
 	// 이외 정보는 file_page 구조체 안에서 가져오기
 	off_t ofs = file_page->ofs;
@@ -83,14 +135,14 @@ file_backed_swap_in (struct page *page, void *kva UNUSED) {
 	ASSERT (page_read_bytes + page_zero_bytes == PGSIZE);
 	ASSERT (ofs % PGSIZE == 0);
 
-	file_seek (file, ofs);
-
 	/* Load this page. */
-	if (file_read (file, page->va, page_read_bytes) != (int) page_read_bytes) {
+	if (file_read_at (file, kva, page_read_bytes, ofs)
+		!= (int) page_read_bytes) {
 		printf("[DBG] lazy_load_file_page(): file_read failed!\n");
 		return false;
 	}
-	memset (page->va + page_read_bytes, 0, page_zero_bytes); // 0 bytes
+	memset (kva + page_read_bytes, 0, page_zero_bytes); // 0 bytes
+	hash_sectors(page, kva);
 
 	return true;
 }
@@ -98,8 +150,7 @@ file_backed_swap_in (struct page *page, void *kva UNUSED) {
 /* Swap out the page by writeback contents to the file. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file *file = get_file_from_hash(&thread_current()->spt.mmap_hash,
-										   page->file.addr);
+	struct file *file = get_page_file(page);
 	file_backed_write_back(page, file);
 	return true;
 }
@@ -107,12 +158,12 @@ file_backed_swap_out (struct page *page) {
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
+	free(page->file.sector_hash);
 }
 
 static bool file_page_lazy_load(struct page *page, void *aux) {
 	struct uninit_page_args *upargs = (struct uninit_page_args*) aux;
-	struct file *file = get_file_from_hash(&thread_current()->spt.mmap_hash,
-											page->file.addr);
+	struct file *file = get_page_file(page);
 	off_t ofs = upargs->ofs;
 	uint32_t page_read_bytes = upargs->page_read_bytes;
 	uint32_t page_zero_bytes = upargs->page_zero_bytes;
@@ -120,43 +171,51 @@ static bool file_page_lazy_load(struct page *page, void *aux) {
 	ASSERT (page_read_bytes + page_zero_bytes == PGSIZE);
 	ASSERT (ofs % PGSIZE == 0);
 
-	file_seek (file, ofs);
-	if (file_read (file, page->va, page_read_bytes) != (int) page_read_bytes) {
+	if (file_read_at (file, page->frame->kva, page_read_bytes, ofs)
+		!= (int) page_read_bytes) {
 		printf("[DBG] file_page_lazy_load(): file_read failed!\n");
 		return false;
 	}
-	memset (page->va + page_read_bytes, 0, page_zero_bytes);
+	memset (page->frame->kva + page_read_bytes, 0, page_zero_bytes);
+	hash_sectors(page, page->frame->kva);
 
 	free(upargs); // file_backed_initializer, file_page_lazy_load에서 사용 끝
 
-	// memset 과정에서 켜진 dirty, accessed bit을 복구
-	uint64_t *pte = pml4e_walk(thread_current()->pml4, page->va, 0);
-	pml4_pte_set_dirty(thread_current()->pml4, pte, page->va, 0);
-	pml4_pte_set_accessed(thread_current()->pml4, pte, page->va, 0);
-
+	// kva로 쓰면서 켜진 dirty bit은 vm_do_claim_page()에서 복구
 	return true;
 }
 
 /* Do the mmap */
-// process.c load_segment()와 거의 유사
+// 영역만 등록하고, 페이지는 처음 접근할 때 mmap_alloc_page()로 만듦
+// 큰 영역을 매핑해도 munmap, 종료 비용은 실제로 접근한 페이지 수에 비례
+// FILE이 NULL이면 0으로 채워진 anonymous 메모리를 매핑 (MAP_ANONYMOUS)
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
 	// 예외처리
-	if (file == NULL || addr == NULL || pg_ofs(addr) != 0
-		|| pg_ofs(offset) != 0 || length == 0 || offset > file_length(file)) {
+	if (addr == NULL || pg_ofs(addr) != 0
+		|| pg_ofs(offset) != 0 || length == 0) {
+		return NULL;
+	}
+	if (file ? offset > file_length(file) : offset != 0) {
 		return NULL;
 	}
 
+	struct supplemental_page_table *spt = &thread_current()->spt;
 	int pg_cnt = (length -1) / PGSIZE +1;
-	for (int i = 0; i < pg_cnt; i++) {
-		if (spt_find_page(&thread_current()->spt, addr + PGSIZE * i)) {
-			// 할당될 페이지가 다른 페이지와 겹치면 실패
-			return NULL;
-		}
+	if (mmap_range_overlaps(spt, addr, length)
+		|| heap_range_overlaps(spt, addr, length)
+		|| (addr < (void *) USER_STACK && (void *) STACK_LIM < addr + length)) {
+		// 다른 mmap, heap, stack 영역과 겹치면 실패 (아직 접근하지 않은 영역 포함)
+		return NULL;
+	}
+	// 나머지 페이지는 heap_start 아래의 실행 파일 segment뿐이므로 그 부분만 확인
+	void *seg_end = spt->heap_start ? spt->heap_start : addr + length;
+	if (addr < seg_end && spt_range_has_page(spt, addr,
+			(addr + length < seg_end ? addr + length : seg_end) - addr)) {
+		return NULL;
 	}
 
-	void *cur_pg = addr;
 	struct mmap_elem *me = malloc(sizeof(*me));
 	if (me == NULL) {
 		printf("[DBG] do_mmap(): malloc for mmap_elem failed!\n");
@@ -165,39 +224,72 @@ do_mmap (void *addr, size_t length, int writable,
 
 	me->addr = addr;
 	me->pg_cnt = pg_cnt;
-	me->file = file_reopen(file);
-	hash_insert(&thread_current()->spt.mmap_hash, &me->elem);
+	me->ofs = offset;
+	// 파일의 끝을 넘어가는 부분은 0으로 채움
+	me->read_bytes = !file ? 0 :
+					 length < (size_t) file_length(file) - offset ?
+					 length : (size_t) file_length(file) - offset;
+	me->writable = writable;
+	me->advice = MADV_NORMAL;
+	me->next_fault = NULL;
+	me->file = file ? file_reopen(file) : NULL;
+	list_init(&me->pages);
+	// kswapd가 get_page_file()로 mmap_hash를 읽으므로 lock 필요
+	lock_acquire(&spt->mmap_lock);
+	hash_insert(&spt->mmap_hash, &me->elem);
+	list_insert_ordered(&spt->mmap_list, &me->list_elem, mmap_list_less, NULL);
+	lock_release(&spt->mmap_lock);
 
-	// 할당 시작
-	uint32_t read_bytes = length < (size_t) file_length(file) - offset ?
-							length : (size_t) file_length(file) - offset;
-	uint32_t zero_bytes = pg_round_up(length) - read_bytes;
-	
-	while (read_bytes > 0 || zero_bytes > 0) {
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		struct uninit_page_args *upargs = malloc(sizeof(*upargs));
-		upargs->addr = addr;
-		upargs->ofs = offset;
-		upargs->page_read_bytes = page_read_bytes;
-		upargs->page_zero_bytes = page_zero_bytes;
-		
-		if (!vm_alloc_page_with_initializer (VM_FILE, cur_pg,
-					writable, file_page_lazy_load, upargs))
-		{
-			printf("[DBG] do_mmap(): vm_alloc_page_with_initializer failed!\n");
-			return NULL;
-		}
+	return addr;
+}
 
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		cur_pg += PGSIZE;
-		offset += PGSIZE;
+// va가 mmap 영역 안이지만 아직 페이지가 없다면 spt에 만들어 넣음
+// process.c load_segment()와 거의 유사하게 한 페이지만 할당
+// 새로 만들었다면 true, mmap 영역이 아니면 false 반환
+bool
+mmap_alloc_page (struct supplemental_page_table *spt, void *va) {
+	struct mmap_elem *me = find_mmap_elem(spt, va);
+	if (!me)
+		return false;
+
+	void *upage = pg_round_down(va);
+	if (!me->file) {
+		// lazy하게 0으로 채워지는 anon 페이지로 할당
+		if (!vm_alloc_anon_zero_page(upage, me->writable))
+			return false;
+		goto link;
 	}
 
-	return addr;
+	uint32_t start = upage - me->addr; // 영역 안에서의 위치
+	uint32_t page_read_bytes = 0;
+	if (start < me->read_bytes) {
+		page_read_bytes = me->read_bytes - start < PGSIZE ?
+						  me->read_bytes - start : PGSIZE;
+	}
+
+	struct uninit_page_args *upargs = vm_alloc_page_args();
+	if (!upargs) {
+		printf("[DBG] mmap_alloc_page(): vm_alloc_page_args failed!\n");
+		return false;
+	}
+	upargs->addr = me->addr;
+	upargs->ofs = me->ofs + start;
+	upargs->page_read_bytes = page_read_bytes;
+	upargs->page_zero_bytes = PGSIZE - page_read_bytes;
+
+	if (!vm_alloc_page_with_initializer (VM_FILE, upage,
+				me->writable, file_page_lazy_load, upargs)) {
+		printf("[DBG] mmap_alloc_page(): vm_alloc_page_with_initializer failed!\n");
+		free(upargs);
+		return false;
+	}
+
+link:
+	// 찾아둔 영역에 바로 연결 (spt_insert_page()는 영역을 다시 찾지 않음)
+	lock_acquire(&frame_list_lock);
+	spt_link_mmap_page(spt, upage, me);
+	lock_release(&frame_list_lock);
+	return true;
 }
 
 /* Do the munmap */
@@ -215,20 +307,259 @@ do_munmap (void *addr) {
 	}
 	struct mmap_elem *me = hash_entry(e, struct mmap_elem, elem);
 
-	struct page *page;
-	// mmap으로 생성된 file_page를 모두 제거
-	for (int i = 0; i < me->pg_cnt; i++) {
-		page = spt_find_page(&thread_current()->spt, addr + PGSIZE * i);
+	// kswapd의 eviction과 겹치지 않도록 lock
+	lock_acquire(&frame_list_lock);
+	mmap_remove_pages(&thread_current()->spt, me);
+	lock_release(&frame_list_lock);
+
+	// swap 중에는 mmap_lock을 잡고 대기하지 않도록 페이지 제거 후에 삭제
+	lock_acquire(&thread_current()->spt.mmap_lock);
+	hash_delete(mmap_hash, &me->elem);
+	list_remove(&me->list_elem);
+	if (thread_current()->spt.mmap_hint == me)
+		thread_current()->spt.mmap_hint = NULL;
+	lock_release(&thread_current()->spt.mmap_lock);
+
+	file_close(me->file);
+	free(me);
+}
+
+/* Do the msync */
+// 범위 안의 dirty 페이지를 unmap하지 않고 파일에 write-back
+int
+do_msync (void *addr, size_t length, int flags) {
+	if (pg_ofs(addr) != 0 || (flags != MS_SYNC && flags != MS_ASYNC))
+		return -1;
+	if (!range_is_mapped(addr, length))
+		return -1;
+
+	if (flags == MS_ASYNC) {
+		// dirty 페이지는 evict, munmap, 종료 시에 write-back이 보장되므로
+		// 따로 할 일 없음
+		return 0;
+	}
 
-		if (page->frame) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	lock_acquire(&frame_list_lock);
+	for (void *va = addr; va < addr + length; va += PGSIZE) {
+		struct mmap_elem *me = find_mmap_elem(spt, va);
+		struct page *page = spt_find_page(spt, va);
+		if (!page)
+			continue; // 아직 접근하지 않은 페이지는 쓸 내용이 없음
+
+		vm_page_wait_io(page); // kswapd가 swap out 중이라면 이미 write-back됨
+		if (me->file && page->frame && vm_page_is_dirty(page)) {
+			// disk I/O 동안 lock을 놓으므로 그 사이 evict되지 않도록 I/O 중으로 표시
+			// 쓰는 도중 다른 sharer가 쓴 내용은 다시 dirty로 남도록 dirty bit을 먼저 지움
+			vm_page_clear_dirty(page);
+			page->io_state = PAGE_IO_OUT;
+			lock_release(&frame_list_lock);
 			file_backed_write_back(page, me->file);
+			lock_acquire(&frame_list_lock);
+			vm_page_io_done(page);
 		}
-		spt_remove_page(&thread_current()->spt, page);
 	}
+	lock_release(&frame_list_lock);
+	return 0;
+}
 
-	file_close(me->file);
-	hash_delete(mmap_hash, &me->elem);
-	free(me);
+/* Do the madvise */
+// NORMAL, RANDOM, SEQUENTIAL은 mmap 영역의 read-ahead 크기를 정하고,
+// WILLNEED, DONTNEED는 범위 안의 페이지를 바로 불러오거나 evict함
+int
+do_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+
+	if (pg_ofs(addr) != 0)
+		return -1;
+
+	switch (advice) {
+		case MADV_NORMAL:
+		case MADV_RANDOM:
+		case MADV_SEQUENTIAL:
+			// 접근 패턴은 mmap 단위로 기록
+			if (!range_is_mapped(addr, length))
+				return -1;
+			for (void *va = addr; va < addr + length; ) {
+				struct mmap_elem *me = find_mmap_elem(spt, va);
+				me->advice = advice;
+				va = mmap_end(me); // 영역마다 한 번만
+			}
+			return 0;
+		case MADV_WILLNEED:
+		case MADV_DONTNEED:
+			for (void *va = addr; va < addr + length; va += PGSIZE) {
+				if (!spt_find_page(spt, va) && !find_mmap_elem(spt, va)
+					&& !heap_range_overlaps(spt, va, 1))
+					return -1;
+			}
+			for (void *va = addr; va < addr + length; va += PGSIZE) {
+				if (advice == MADV_WILLNEED)
+					vm_claim_page(va);
+				else // 내용은 swap (또는 파일)에 보존됨
+					vm_evict_page(va);
+			}
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+// fault로 불러온 mmap 페이지 다음의 페이지들을 미리 읽음
+// MADV_SEQUENTIAL 영역은 한참 지나온 페이지를 바로 evict (drop-behind)
+void
+file_backed_readahead (struct page *page) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct mmap_elem *me = find_mmap_elem(spt, page->va);
+	if (!me)
+		return;
+
+	void *va = page->va;
+	void *map_end = me->addr + me->pg_cnt * PGSIZE;
+	int window;
+	switch (me->advice) {
+		case MADV_SEQUENTIAL:
+			window = READAHEAD_SEQ;
+			break;
+		case MADV_RANDOM:
+			window = 0;
+			break;
+		default:
+			// 직전 fault의 바로 다음 페이지라면 sequential 접근으로 판단
+			window = va == me->next_fault ? READAHEAD_NORMAL : 0;
+	}
+
+	int i;
+	for (i = 1; i <= window && va + i * PGSIZE < map_end; i++) {
+		vm_claim_page(va + i * PGSIZE);
+	}
+	// 미리 읽은 구간 다음에서 fault가 나면 sequential 접근
+	me->next_fault = va + i * PGSIZE;
+
+	if (me->advice == MADV_SEQUENTIAL) {
+		// 직전 구간보다 더 앞의 구간은 다시 읽지 않을 것으로 판단
+		size_t stride = (READAHEAD_SEQ + 1) * PGSIZE;
+		if (va < me->addr + 2 * stride)
+			return;
+		for (void *b = va - 2 * stride; b < va - stride; b += PGSIZE) {
+			struct page *behind = spt_find_page(spt, b);
+			if (behind && behind->share_cnt == 1)
+				vm_evict_page(b);
+		}
+	}
+}
+
+// va를 포함하는 mmap_elem을 반환, 없으면 NULL
+// 같은 영역 안의 연속된 접근 (fault, 시스템 콜의 페이지 루프)은 hint에서 바로 찾고,
+// 아니면 addr 순으로 정렬된 mmap_list를 va를 넘는 영역까지만 탐색
+struct mmap_elem *find_mmap_elem(struct supplemental_page_table *spt,
+								 void *va) {
+	struct mmap_elem *me = spt->mmap_hint;
+	struct list_elem *e;
+
+	if (me && me->addr <= va && va < mmap_end(me))
+		return me;
+
+	// mmap_list는 자신만 수정하므로 읽을 때는 lock 불필요
+	for (e = list_begin(&spt->mmap_list); e != list_end(&spt->mmap_list);
+		 e = list_next(e)) {
+		me = list_entry(e, struct mmap_elem, list_elem);
+		if (va < me->addr)
+			break; // 이후의 영역은 모두 va보다 뒤에 있음
+		if (va < mmap_end(me)) {
+			spt->mmap_hint = me;
+			return me;
+		}
+	}
+	return NULL;
+}
+
+// [addr, addr + length)가 spt의 mmap 영역 중 하나와 겹치는지 여부
+bool mmap_range_overlaps(struct supplemental_page_table *spt,
+						 void *addr, size_t length) {
+	struct list_elem *e;
+	void *end = pg_round_up(addr + length);
+
+	for (e = list_begin(&spt->mmap_list); e != list_end(&spt->mmap_list);
+		 e = list_next(e)) {
+		struct mmap_elem *me = list_entry(e, struct mmap_elem, list_elem);
+		if (me->addr >= end)
+			break;
+		if (addr < mmap_end(me))
+			return true;
+	}
+	return false;
+}
+
+// [addr, addr + length)의 모든 페이지가 현재 쓰레드의 mmap 영역인지 여부
+// 페이지마다가 아니라 영역마다 한 번씩 찾음
+static bool range_is_mapped(void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+
+	for (void *va = addr; va < addr + length; ) {
+		struct mmap_elem *me = find_mmap_elem(spt, va);
+		if (!me)
+			return false;
+		va = mmap_end(me);
+	}
+	return true;
+}
+
+// mmap_list를 addr 순으로 정렬
+static bool mmap_list_less(const struct list_elem *a,
+						   const struct list_elem *b, void *aux UNUSED) {
+	return list_entry(a, struct mmap_elem, list_elem)->addr
+		   < list_entry(b, struct mmap_elem, list_elem)->addr;
+}
+
+// mmap 영역의 끝 주소 (포함하지 않음)
+static void *mmap_end(struct mmap_elem *me) {
+	return me->addr + me->pg_cnt * PGSIZE;
+}
+
+// 파일에서 읽어온 kva의 내용으로 섹터별 hash를 계산
+static void hash_sectors(struct page *page, void *kva) {
+	struct file_page *file_page = &page->file;
+	uint32_t read_bytes = file_page->page_read_bytes;
+
+	if (!file_page->sector_hash)
+		return;
+	for (uint32_t start = 0; start < read_bytes; start += DISK_SECTOR_SIZE) {
+		uint32_t len = read_bytes - start < DISK_SECTOR_SIZE ?
+					   read_bytes - start : DISK_SECTOR_SIZE;
+		file_page->sector_hash[start / DISK_SECTOR_SIZE] =
+										hash_bytes((uint8_t *) kva + start, len);
+	}
+}
+
+// kva의 [start, end) 구간을 파일의 같은 위치에 씀
+static void write_back_range(struct file *file, struct file_page *file_page,
+							 uint8_t *kva, uint32_t start, uint32_t end) {
+	if (start == end)
+		return;
+
+	// evict 중인 페이지를 기다리는 연산이 있을 수 있으므로 commit을 기다리지 않음
+	journal_begin_nowait();
+	int bytes_written = file_write_at(file, kva + start, end - start,
+									  file_page->ofs + start);
+	journal_end();
+	if (bytes_written != (int) (end - start)) {
+		printf("[DBG] file_backed_write_back(): error while writting back");
+	}
+}
+
+// 페이지를 공유중인 첫 번째 spt의 mmap_hash에서 파일 구조체를 가져옴
+// 현재 쓰레드와 무관하게 동작하므로 kswapd에서도 사용 가능
+static struct file *get_page_file(struct page *page) {
+	ASSERT(!list_empty(&page->share_list));
+
+	struct spt_elem *se = list_entry(list_begin(&page->share_list),
+									 struct spt_elem, elem);
+	// swap은 frame_list_lock 없이 수행되므로 mmap_hash는 별도의 lock으로 보호
+	lock_acquire(&se->spt->mmap_lock);
+	struct file *file = get_file_from_hash(&se->spt->mmap_hash, page->file.addr);
+	lock_release(&se->spt->mmap_lock);
+	return file;
 }
 
 // mmap_hash에서 addr에 해당하는 파일 구조체 포인터를 반환
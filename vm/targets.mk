@@ -3,3 +3,6 @@ vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
 vm_SRC += vm/inspect.c    # Testing utility
+vm_SRC += vm/evict.c      # Eviction policy interface, FIFO/LLRU/Clock/2Q
+vm_SRC += vm/clockpro.c   # CLOCK-Pro eviction policy
+vm_SRC += vm/arc.c        # ARC (CAR) eviction policy
@@ -1,18 +1,91 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/evict.h"
+#include "threads/interrupt.h"
+#include "filesys/inode.h"
+#include "devices/timer.h"
+
+// 미리 0으로 채워둔 user pool 프레임 풀 (zerod 쓰레드가 채움)
+#define ZERO_POOL_LOW 8 // 풀에 남은 프레임이 이보다 적으면 zerod를 깨움
+#define ZERO_POOL_HIGH 32 // zerod가 채워두는 최대 프레임 수
+
+static struct list zero_pool; // 0으로 채워진 kva의 리스트 (페이지 맨 앞에 elem)
+static size_t zero_pool_cnt;
+static struct lock zero_pool_lock;
+static struct semaphore zerod_sema; // zerod가 풀을 다시 채울 때까지 대기
+static bool zerod_idle; // zerod가 sema_down으로 잠들어있는지 여부
+static void zerod(void *aux UNUSED);
+
+// 남은 빈 프레임이 low 아래로 떨어지면 kswapd가 깨어나 high까지 미리 evict
+#define KSWAPD_LOW_MIN 16 // low watermark의 최소값
+#define KSWAPD_LOW_DIV 64 // low watermark = user pool 크기 / 64
+#define KSWAPD_BATCH 8 // lock을 한 번 잡고 evict할 최대 프레임 수
+#define AGE_BATCH (KSWAPD_BATCH * 8) // batch마다 aging pass가 확인할 프레임 수
+
+static size_t kswapd_low; // 빈 프레임이 이보다 적으면 kswapd를 깨움
+static size_t kswapd_high; // kswapd가 확보하려는 빈 프레임 수
+static struct semaphore kswapd_sema;
+static bool kswapd_idle; // kswapd가 sema_down으로 잠들어있는지 여부
+static void kswapd(void *aux UNUSED);
+
+// 같은 va에 같은 내용을 가진 anon 페이지를 찾아 하나의 페이지로 병합 (-ksm)
+// 병합된 페이지는 fork와 같은 write-protect 상태가 되어, 쓰면 vm_handle_wp()로 분리됨
+#define KSM_SCAN_TICKS 10 // ksmd가 깨어나는 주기
+#define KSM_BATCH 128 // 한 번 깨어났을 때 lock을 잡고 hash할 프레임 수
+
+bool vm_ksm_enabled;
+static struct hash ksm_table; // 이번 scan에서 본 병합 후보 (struct ksm_node)
+static size_t ksm_cursor; // 다음에 확인할 frame_table의 index
+static size_t ksm_merged; // 지금까지 병합해 해제한 페이지 수
+static void ksmd(void *aux UNUSED);
+
+// 병합 후보 프레임: 내용이 두 번 연속 같은 hash였던 프레임
+// 프레임은 scan 사이에 해제될 수 있으므로 index로 저장하고 사용 전에 다시 확인
+struct ksm_node {
+	size_t idx; // frame_table의 index
+	void *va;
+	uint64_t sum;
+	struct hash_elem elem;
+};
+
+// 실행 파일의 read-only 페이지 공유 (struct text_page), frame_list_lock으로 보호
+static struct hash text_table;
+// text table에서 제거됐지만 아직 inode를 닫지 않은 항목
+// inode_close()는 파일 시스템의 lock, disk I/O를 사용하므로 lock 밖에서 닫음
+static struct list text_dead;
+static void text_close_dead(void);
+static bool text_page_less_func (const struct hash_elem *a,
+		const struct hash_elem *b, void *aux UNUSED);
+static uint64_t text_page_hash_func(const struct hash_elem *e, void *aux UNUSED);
+static bool ksm_node_less_func (const struct hash_elem *a,
+		const struct hash_elem *b, void *aux UNUSED);
+static uint64_t ksm_node_hash_func(const struct hash_elem *e, void *aux UNUSED);
 
-#define STACK_LIM 0x47380000 // 47480000 + 1MB
+// 한 번도 쓰지 않은 anon 페이지를 읽으면 실제 프레임 대신 read-only로 매핑하는 페이지
+// user pool 밖 (kernel pool)에 있으므로 eviction policy와 frame table에 속하지 않음
+static void *zero_page;
 
-enum ep_enum { // evict policy
-	EP_FIFO = 0, // First in First out
-	EP_LLRU = 1, // Lenient LRU
-	EP_CLCK = 2, // Clock Algorithm (second wind)
-};
+// 페이지의 I/O가 끝나거나 프레임이 반환될 때 broadcast (frame_list_lock과 함께 사용)
+static struct condition page_io_cond;
 
-enum ep_enum evict_policy = EP_CLCK;
+// user pool의 물리 페이지 순서대로 frame을 저장 (aging pass에서 사용)
+static struct frame **frame_table;
+static uint8_t *frame_table_base; // user pool의 첫 번째 페이지의 kva
+static size_t frame_table_cnt;
+static size_t age_cursor; // aging pass가 다음에 확인할 frame_table의 index
+
+// fault 경로에서 자주 할당하는 구조체의 slab cache
+// slab object는 free()로도 해제되므로 vm_dealloc_page(), upargs의 free()는 그대로 사용
+static struct slab_cache page_cache;
+static struct slab_cache page_elem_cache;
+static struct slab_cache spt_elem_cache;
+static struct slab_cache frame_cache;
+static struct slab_cache upargs_cache;
+static void frame_ctor(void *frame);
 
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
@@ -27,24 +100,61 @@ vm_init (void) {
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	switch (evict_policy) {
-		case EP_FIFO:
-			// FIFO: frame_list에 먼저 삽입된 (가장 오래된) 프레임 선택
-			list_init(&frame_list); // 물리 메모리 user pool에 할당된 프레임의 리스트
-			break;
-		case EP_LLRU:
-			// lenient LRU: 마지막 eivction 이후 access되지 않은 프레임에 대해 FIFO
-			list_init(&frame_list);
-			list_push_back(&frame_list, &frame_nil.elem); // sentinel 용도
-			break;
-		case EP_CLCK:
-			// clock algorith (second wind)
-			frame_nil.elem.next = &frame_nil.elem; // 순환 리스트
-			frame_nil.elem.prev = &frame_nil.elem;
-			break;
-	}
+	slab_cache_init(&page_cache, "page", sizeof(struct page), NULL);
+	slab_cache_init(&page_elem_cache, "page_elem", sizeof(struct page_elem), NULL);
+	slab_cache_init(&spt_elem_cache, "spt_elem", sizeof(struct spt_elem), NULL);
+	slab_cache_init(&frame_cache, "frame", sizeof(struct frame), frame_ctor);
+	slab_cache_init(&upargs_cache, "upargs", sizeof(struct uninit_page_args), NULL);
+
+	// frame table 초기화
+	frame_table_base = palloc_pool_base(PAL_USER);
+	frame_table_cnt = palloc_page_cnt(PAL_USER);
+	age_cursor = 0;
+	frame_table = calloc(frame_table_cnt, sizeof *frame_table);
+	if (!frame_table)
+		PANIC("[DBG] vm_init(): malloc for frame_table failed\n");
+
+	// 커널 옵션 -evict=NAME으로 선택된 정책 (기본값 clock)
+	evict_policy_init(palloc_page_cnt(PAL_USER));
+
+	zero_page = palloc_get_page(PAL_ZERO);
+	if (!zero_page)
+		PANIC("[DBG] vm_init(): palloc for zero_page failed\n");
 
 	lock_init(&frame_list_lock);
+	cond_init(&page_io_cond);
+	hash_init(&text_table, text_page_hash_func, text_page_less_func, NULL);
+	list_init(&text_dead);
+
+	// zero pool 초기화 후 채우는 쓰레드 생성
+	list_init(&zero_pool);
+	zero_pool_cnt = 0;
+	lock_init(&zero_pool_lock);
+	sema_init(&zerod_sema, 0);
+	zerod_idle = false;
+	thread_create("zerod", PRI_MIN, zerod, NULL);
+
+	// watermark 계산 후 page-out 쓰레드 생성
+	kswapd_low = palloc_page_cnt(PAL_USER) / KSWAPD_LOW_DIV;
+	if (kswapd_low < KSWAPD_LOW_MIN)
+		kswapd_low = KSWAPD_LOW_MIN;
+	kswapd_high = kswapd_low * 2;
+	sema_init(&kswapd_sema, 0);
+	kswapd_idle = false;
+	thread_create("kswapd", PRI_DEFAULT, kswapd, NULL);
+
+	if (vm_ksm_enabled) {
+		hash_init(&ksm_table, ksm_node_hash_func, ksm_node_less_func, NULL);
+		ksm_cursor = 0;
+		thread_create("ksmd", PRI_DEFAULT, ksmd, NULL);
+	}
+}
+
+/* Prints VM statistics. */
+void
+vm_print_stats (void) {
+	if (vm_ksm_enabled)
+		printf ("KSM: merged %zu pages\n", ksm_merged);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -65,23 +175,48 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static void vm_page_out (struct frame *frame);
+static bool page_needs_zero(struct page *page);
+static struct frame *new_frame(void *kva);
+static void vm_free_frame(struct frame *frame);
+
+// Zero pool helpers
+static void *zero_pool_get(void);
+
+// Page-out daemon helpers
+static size_t free_frame_cnt(void);
+static void kswapd_wakeup(void);
+static void unmap_page_from_sharers(struct page *page);
+
+// Frame table helpers
+static void frame_table_set(void *kva, struct frame *frame);
+static void vm_age_frames(void);
+
+// Same-page merging helpers
+static bool ksm_mergeable(struct page *page);
+static bool ksm_scan_frame(size_t idx);
+static bool ksm_merge(struct page *stable, struct page *dup);
 
 static struct page_elem *new_page_elem(struct page *page);
+static struct page_elem *find_page_elem(struct supplemental_page_table *spt,
+										void *va);
 static struct spt_elem *new_spt_elem(struct supplemental_page_table *spt);
+static struct spt_elem *find_spt_elem(struct supplemental_page_table *spt,
+														struct page *page);
+static bool map_page(struct spt_elem *se, struct page *page, bool writable);
+static bool map_zero_page(struct spt_elem *se, struct page *page);
 
 static void subscribe_page(struct supplemental_page_table *spt,
 														struct page *page);
 static void unsubscribe_page(struct supplemental_page_table *spt,
 														struct page *page);
 
-// Evict policy helpers
-static void insert_into_frame_list(struct frame *frame);
-static void push_accessed_frame_back(void); // Leninent LRU
-static struct frame *second_wind(void); // Clock Algorithm
-
 // SPT copy helpers
 static bool copy_page(struct page *old_page, struct page *new_page);
-static void copy_mmap_hash(struct hash *old_h, struct hash *new_h);
+static void copy_mmap_hash(struct supplemental_page_table *src,
+						   struct supplemental_page_table *dst);
+
+static void mmap_write_back_page(struct mmap_elem *me, struct page_elem *pe);
 
 // Hash table helpers
 static bool page_va_less_func (const struct hash_elem *a,
@@ -92,6 +227,7 @@ static bool mmap_addr_less_func (const struct hash_elem *a,
 		const struct hash_elem *b, void *aux UNUSED);
 static uint64_t mmap_addr_hash_func(const struct hash_elem *e, void *aux UNUSED);
 static void mmap_hash_destructor(struct hash_elem *e, void *aux);
+static void ksm_node_destructor(struct hash_elem *e, void *aux UNUSED);
 
 
 /* Create the pending page object with initializer. If you want to create a
@@ -105,6 +241,8 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 	struct supplemental_page_table *spt = &thread_current ()->spt;
 
+	// ksmd가 spt를 hash_find하므로 삽입이 끝날 때까지 lock
+	lock_acquire(&frame_list_lock);
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
 		/* TODO: Create the page, fetch the initialier according to the VM type,
@@ -125,9 +263,9 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 				printf("[DBG] vm_alloc_page_with_initializer(): unknown page type (%d)\n", VM_TYPE(type));
 		}
 
-		struct page *page = malloc(sizeof(*page));
+		struct page *page = slab_alloc(&page_cache);
 		if (!page)
-			PANIC("[DBG] vm_alloc_page_with_initializer(): malloc for page failed!\n");
+			PANIC("[DBG] vm_alloc_page_with_initializer(): slab_alloc for page failed!\n");
 
 		// 새로운 uninit page를 제작
 		uninit_new(page, upage, init, type, aux, initializer);
@@ -135,43 +273,84 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		page->writable = writable;
 		list_init(&page->share_list); // 현재 페이지를 '구독'중인 spt의 목록
 		page->share_cnt = 0;
+		page->ghost = 0;
+		page->io_state = PAGE_IO_NONE;
+		page->io_waiters = 0;
+		page->text = NULL;
 
 		/* TODO: Insert the page into the spt. */
 		// spt에 새로운 페이지를 삽입
 		if (!spt_insert_page(spt, page)) {
 			printf("[DBG] vm_alloc_page_with_initializer(): spt_insert_page failed\n");
-			free(page);
+			slab_free(page);
 			goto err;
 		}
 
+		lock_release(&frame_list_lock);
 		return true;
 	} else {
 		printf("[DBG] vm_alloc_page_with_initializer(): upage is already in spt!\n");
 		goto err;
 	}
 err:
+	lock_release(&frame_list_lock);
 	return false;
 }
 
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
 spt_find_page (struct supplemental_page_table *spt, void *va) {
-	struct page temp_page;
-	struct page_elem temp_pe;
-	temp_page.va = pg_round_down(va);
-	temp_pe.page = &temp_page;
+	struct page_elem *pe = find_page_elem(spt, va);
+	return pe ? pe->page : NULL;
+}
 
-	struct hash_elem *e = hash_find(&spt->hash, &temp_pe.elem);
-	return e ? hash_entry(e, struct page_elem, elem)->page : NULL;
+// [addr, addr + length)에 spt의 페이지가 하나라도 있는지 여부
+// 범위의 페이지 수와 spt의 페이지 수 중 적은 쪽만큼만 확인
+bool
+spt_range_has_page (struct supplemental_page_table *spt,
+					void *addr, size_t length) {
+	void *end = addr + length;
+
+	if (length / PGSIZE <= hash_size(&spt->hash)) {
+		for (void *va = pg_round_down(addr); va < end; va += PGSIZE)
+			if (spt_find_page(spt, va))
+				return true;
+		return false;
+	}
+
+	struct hash_iterator i;
+	hash_first(&i, &spt->hash);
+	while (hash_next(&i)) {
+		struct page *page = hash_entry(hash_cur(&i), struct page_elem, elem)->page;
+		if (addr < page->va + PGSIZE && page->va < end)
+			return true;
+	}
+	return false;
 }
 
 /* Insert PAGE into spt with validation. */
+// mmap 영역의 페이지라면 삽입한 쪽에서 spt_link_mmap_page()로 영역에 연결
 bool
 spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
 	subscribe_page(spt, page); // page의 share_list에 참여시킴
 
 	struct page_elem *pe = new_page_elem(page); // spt에 삽입할 구조체
-	return !hash_insert(&spt->hash, &pe->elem);
+	if (hash_insert(&spt->hash, &pe->elem))
+		return false;
+	return true;
+}
+
+// spt에 삽입된 va의 페이지를 mmap 영역 ME에 연결
+// munmap, 종료 시에 영역의 페이지만 순회할 수 있도록
+void
+spt_link_mmap_page (struct supplemental_page_table *spt, void *va,
+					struct mmap_elem *me) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+
+	struct page_elem *pe = find_page_elem(spt, va);
+	ASSERT(pe != NULL && pe->mmap == NULL);
+	pe->mmap = me;
+	list_push_back(&me->pages, &pe->mmap_link);
 }
 
 void
@@ -181,98 +360,114 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 
 	struct hash_elem *e = hash_delete(&spt->hash, &temp_pe.elem);
 	struct page_elem *pe = hash_entry(e, struct page_elem, elem);
-	free(pe);
+	if (pe->mmap)
+		list_remove(&pe->mmap_link);
+	slab_free(pe);
 
 	unsubscribe_page(spt, page); // page의 share_list에서 제거
 }
 
 /* Get the struct frame, that will be evicted. */
+// 선택된 프레임은 eviction policy의 관리 대상에서 제거된 상태로 반환됨
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
-
-	switch (evict_policy) {
-		case EP_FIFO:
-			// FIFO: frame_list에 먼저 삽입된 (가장 오래된) 프레임 선택
-			ASSERT(!list_empty(&frame_list));
-			victim = list_entry(list_begin(&frame_list), struct frame, elem);
-			break;
-		case EP_LLRU:
-			// lenient LRU: 마지막 eivction 이후 access되지 않은 프레임 중 FIFO
-			ASSERT(list_next(&frame_nil.elem) != list_end(&frame_list));
-			victim = list_entry(list_next(&frame_nil.elem), struct frame, elem);
-			break;
-		case EP_CLCK:
-			// clock algorith (second wind)
-			ASSERT(list_next(&frame_nil.elem) != &frame_nil.elem);
-			victim = second_wind();
-			break;
-	}
-
-	return victim;
+	ASSERT(!evict_policy->empty());
+	return evict_policy->victim();
 }
 
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.*/
+// swap out 동안 frame_list_lock을 놓았다가 다시 잡고 반환
 static struct frame *
 vm_evict_frame (void) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
 	struct frame *victim = vm_get_victim ();
+	vm_page_out(victim);
 
-	// victim을 swap out
-	if (!swap_out(victim->page)) {
-		PANIC("[DBG] vm_evict_frame(): swap out for victim page failed\n");
-	}
+	// 받아낸 frame을 반환
+	return victim;
+}
 
-	// '구독'중인 모든 spt의 pml4에서 삭제
-	struct list *share_list = &victim->page->share_list;
-	struct list_elem *e;
-	struct spt_elem *se;
-	for (e = list_begin(share_list);
-		 e != list_end(share_list); e = list_next(e)) {
-		se = list_entry(e, struct spt_elem, elem);
-		pml4_clear_page(se->spt->pml4, victim->page->va);
+// 정책에서 제거된 프레임의 페이지를 swap out하고 연결을 끊음
+// swap out 동안 frame_list_lock을 놓았다가 다시 잡고 반환
+static void
+vm_page_out (struct frame *victim) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+	struct page *page = victim->page;
+
+	// '구독'중인 모든 spt의 pml4에서 먼저 삭제
+	// kswapd가 evict하는 동안 다른 쓰레드가 페이지에 쓰지 못하도록
+	unmap_page_from_sharers(page);
+
+	// victim을 swap out (disk I/O 동안 다른 쓰레드의 fault를 막지 않도록 lock 해제)
+	page->io_state = PAGE_IO_OUT;
+	lock_release(&frame_list_lock);
+	bool succ = swap_out(page);
+	lock_acquire(&frame_list_lock);
+	if (!succ) {
+		PANIC("[DBG] vm_page_out(): swap out for victim page failed\n");
 	}
 
-	list_remove(&victim->elem); // frame_list에서 제거
 	// page <-> frame 끊기
-	victim->page->frame = NULL;
+	page->frame = NULL;
 	victim->page = NULL;
-
-	// 받아낸 frame을 반환
-	return victim;
+	victim->referenced = false;
+	vm_page_io_done(page);
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
  * space.*/
+// ZERO가 true면 0으로 채워진 프레임을 반환
+// swap in, file load처럼 페이지 전체를 덮어쓰는 경우 false로 호출하여 memset 생략
+// evict가 필요할 때만 frame_list_lock을 잡으므로, lock 없이 호출해야 함
 static struct frame *
-vm_get_frame (void) {
-	if (evict_policy == EP_LLRU &&
-		list_next(&frame_nil.elem) != list_end(&frame_list)) {
-		// accessed인 프레임을 스택의 맨 뒤로 보냄 (lenient LRU)
-		push_accessed_frame_back();
-	}
+vm_get_frame (bool zero) {
+	ASSERT(!lock_held_by_current_thread(&frame_list_lock));
+
+	void *kva = NULL;
+	bool zeroed = false; // 프레임이 이미 0으로 채워져있는지 여부
 
-	void *kva = palloc_get_page(PAL_USER | PAL_ZERO);
+	if (zero) {
+		// 0이 필요하면 zero pool에서 먼저 가져옴
+		kva = zero_pool_get();
+		zeroed = kva != NULL;
+	}
+	if (!kva) {
+		kva = palloc_get_page(PAL_USER);
+	}
+	if (free_frame_cnt() < kswapd_low) {
+		// 빈 프레임이 부족해짐: kswapd가 미리 evict하도록 깨움
+		kswapd_wakeup();
+	}
+	if (!kva) {
+		// user pool에 빈 페이지가 없음: evict 전에 zero pool의 프레임 사용
+		kva = zero_pool_get();
+		zeroed = kva != NULL;
+	}
 
 	struct frame *frame = NULL;
 	if (kva) {
 		// 빈 프레임을 성공적으로 할당받음: 새로운 frame 구조체 생성
-		frame = calloc(sizeof(*frame), 1);
-		if (!frame) {
-			PANIC("[DBG] vm_get_frame(): malloc for frame failed\n");
-		}
-		// frame의 kva, kernel pml4의 pte는 절대 변하지 않음
-		frame->kva = kva;
-		frame->kpte = pml4e_walk(base_pml4, kva, 0);
+		frame = new_frame(kva);
 	} else {
 		// 빈 프레임이 없음: evict하여 공간 확보
-		frame = vm_evict_frame();
+		lock_acquire(&frame_list_lock);
+		while (evict_policy->empty()) {
+			// 모든 프레임이 I/O 중임: 끝나거나 프레임이 반환될 때까지 대기
+			cond_wait(&page_io_cond, &frame_list_lock);
+			kva = palloc_get_page(PAL_USER);
+			if (kva)
+				break;
+		}
+		frame = kva ? new_frame(kva) : vm_evict_frame();
+		lock_release(&frame_list_lock);
 	}
 
-	// 프레임 리스트에 삽입
-	insert_into_frame_list(frame);
+	if (zero && !zeroed) {
+		memset(frame->kva, 0, PGSIZE);
+	}
 
 	// dirty, accessed bit을 복구
 	pml4_pte_set_dirty(base_pml4, frame->kpte, frame->kva, false);
@@ -288,9 +483,10 @@ static void
 vm_stack_growth (struct supplemental_page_table *spt, void *addr) {
 	void *stack_pg = pg_round_down(addr);
 
-	while (spt_find_page(spt, stack_pg) == NULL) {
-		// 할당된 페이지를 만날 때까지 새로운 스택 페이지를 할당
-		struct uninit_page_args *upargs = malloc(sizeof(*upargs));
+	while (spt_find_page(spt, stack_pg) == NULL
+		   && !find_mmap_elem(spt, stack_pg)) {
+		// 할당된 페이지나 mmap 영역을 만날 때까지 새로운 스택 페이지를 할당
+		struct uninit_page_args *upargs = vm_alloc_page_args();
 		upargs->is_stack = true;
 
 		if (!vm_alloc_page_with_initializer(VM_ANON, stack_pg,
@@ -310,7 +506,7 @@ vm_stack_growth (struct supplemental_page_table *spt, void *addr) {
 
 /* Handle the fault on write_protected page */
 static bool
-vm_handle_wp (struct page *old_page) {
+vm_handle_wp (void *va) {
 	// write protect된 page에 write을 하려다가 fault가 난 상황
 	
 	// 페이지는 물리 메모리 상에 있어야 함
@@ -321,53 +517,71 @@ vm_handle_wp (struct page *old_page) {
 	// 5. 기존 페이지를 spt에서 제거
 	// 6. 새로운 페이지를 spt에 넣기
 
-	ASSERT(old_page->frame);
-	ASSERT(old_page->share_cnt > 1);
-
-	void *va = old_page->va;
+	// frame은 lock을 잡기 전에 kswapd가 evict했을 수 있으므로 아래에서 확인
+	struct supplemental_page_table *spt = &thread_current()->spt;
 
 	// 새 페이지 만들기
-	struct page *new_page = malloc(sizeof(*new_page));
+	struct page *new_page = slab_alloc(&page_cache);
 	if (new_page == NULL) {
-		printf("[DBG] vm_handle_wp(): malloc for new_page failed\n");
+		printf("[DBG] vm_handle_wp(): slab_alloc for new_page failed\n");
 		return false;
 	}
+
+	// 새로운 프레임 할당받기 (memcpy로 전부 덮어쓰므로 0으로 채울 필요 없음)
+	// policy에 등록하기 전이므로 evict되지 않음
+	struct frame *new_frame = vm_get_frame(false);
+
+	lock_acquire(&frame_list_lock);
+	// lock을 기다리는 동안 ksmd가 병합했거나 다른 공유자가 떠났을 수 있으므로 다시 찾음
+	struct page *old_page = spt_find_page(spt, va);
+	if (old_page->share_cnt == 1) {
+		// 더 이상 공유되지 않음: write-protect가 이미 풀렸으므로 다시 시도하면 됨
+		vm_free_frame(new_frame);
+		lock_release(&frame_list_lock);
+		slab_free(new_page);
+		return true;
+	}
 	// 페이지 복사
 	if (!copy_page(old_page, new_page)) {
 		printf("[DBG] vm_handle_wp(): copy_page() failed\n");
-		free(new_page);
+		vm_free_frame(new_frame);
+		lock_release(&frame_list_lock);
+		slab_free(new_page);
 		return false;
 	}
 
-	lock_acquire(&frame_list_lock);
-
-	// 새로운 프레임 할당받기
-	struct frame *new_frame = vm_get_frame();
-	if (old_page->frame == NULL) {
-		// 기존 페이지가 evict되었음, 다시 불러오기
-		vm_do_claim_page(old_page);
+	// 기존 페이지가 evict되었다면 다시 불러오기
+	if (!vm_do_claim_page(old_page)) {
+		printf("[DBG] vm_handle_wp(): vm_do_claim_page() failed\n");
+		vm_free_frame(new_frame);
+		lock_release(&frame_list_lock);
+		slab_free(new_page);
+		return false;
 	}
 
 	// 복사한 페이지 세팅
 	new_page->frame = new_frame;
 	new_frame->page = new_page;
 	ASSERT(new_page->va == va);
+	evict_policy->insert(new_frame);
 
 	// 프레임 복사
 	memcpy(new_frame->kva, old_page->frame->kva, PGSIZE);
 
-	// 기존 페이지 제거
-	pml4_clear_page(thread_current()->pml4, va); // pml4에서 제거
-	spt_remove_page(&thread_current()->spt, old_page); // spt에서 제거
+	// 기존 페이지 제거 (pml4에서도 제거됨)
+	struct mmap_elem *me = find_page_elem(spt, va)->mmap;
+	spt_remove_page(spt, old_page); // spt에서 제거
 
 	// 새 페이지 삽입
-	if (!spt_insert_page(&thread_current()->spt, new_page)) { // spt에 삽입
+	if (!spt_insert_page(spt, new_page)) { // spt에 삽입
 		printf("[DBG] vm_handle_wp(): spt_insert_page() failed\n");
 		return false;
 	}
+	if (me)
+		spt_link_mmap_page(spt, va, me); // 복사본도 같은 mmap 영역의 페이지
 
-	if (!pml4_set_page(thread_current()->pml4, va,
-					   new_frame->kva, new_page->writable)) { // pml4에 삽입
+	if (!map_page(find_spt_elem(spt, new_page), new_page,
+				  new_page->writable)) { // pml4에 삽입
 		printf("[DBG] vm_handle_wp(): pml4_set_page() failed\n");
 		return false;
 	}
@@ -389,29 +603,61 @@ vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 	//			i. uninit이라서 없음
 	//			ii. sawp out 당해서 없음
 	// 				-> 둘 다 claim으로 해결
+	//				(0으로 채워질 페이지를 읽기만 하면 공유 zero 페이지를 매핑)
 	// 		b. write 금지에 시도함
 	//			i. 진짜 write 금지임: false 반환
 	//			ii. write protected임: copy on write 하기
+	//			iii. 공유 zero 페이지에 처음 씀: claim으로 해결
 	// 2. va가 할당되지 않은 경우
 	// 		a. stack growth
 	// 		b. 엉뚱한 접근: terminate
 
 	struct supplemental_page_table *spt = &thread_current ()->spt;
 	struct page *page = spt_find_page(spt, addr);
+	if (!page && (mmap_alloc_page(spt, addr) || heap_alloc_page(spt, addr))) {
+		// mmap, heap 영역에 처음 접근: 이제서야 페이지를 만듦
+		page = spt_find_page(spt, addr);
+	}
 
 	if (page) {
 		// 할당된 va로의 접근
 		if (not_present) {
 			// uninit이거나 swap out당해서 없음
 			lock_acquire(&frame_list_lock);
-			succ = vm_do_claim_page (page);	
+			// lock을 기다리는 동안 ksmd가 다른 페이지로 병합했을 수 있음
+			page = spt_find_page(spt, addr);
+			vm_page_wait_io(page);
+			if (page->frame) {
+				// lock을 기다리는 동안 공유중인 다른 쓰레드가 이미 claim함
+				if (evict_policy->touch)
+					evict_policy->touch(page->frame);
+				succ = true;
+			} else if (!write && page_needs_zero(page)) {
+				// 아직 쓴 적 없는 anon 페이지를 읽음: 프레임 없이 zero 페이지 매핑
+				succ = map_zero_page(find_spt_elem(spt, page), page);
+			} else {
+				succ = vm_do_claim_page (page);
+			}
+			bool is_file = page_get_type(page) == VM_FILE;
 			lock_release(&frame_list_lock);
+
+			if (succ && is_file) {
+				// mmap 영역이면 접근 패턴에 따라 다음 페이지를 미리 읽음
+				file_backed_readahead(page);
+			}
 			goto done;
 		} else if (write) {
 			// present지만 write을 시도했다가 fault 발생: 금지된 쓰기
-			if (page->share_cnt > 1 && page->writable) {
+			if (page->writable && page_needs_zero(page)) {
+				// 공유 zero 페이지에 처음 쓰기: 이제서야 프레임을 할당
+				// (다른 공유자가 먼저 claim했다면 그 프레임이 이미 매핑되어 있음)
+				lock_acquire(&frame_list_lock);
+				succ = vm_do_claim_page(spt_find_page(spt, addr));
+				lock_release(&frame_list_lock);
+				goto done;
+			} else if (page->share_cnt > 1 && page->writable) {
 				// write-protect 상태의 페이지임
-				if (!vm_handle_wp(page)) {
+				if (!vm_handle_wp(page->va)) {
 					printf("[DBG] vm_try_handle_fault(): vm_handle_wp() failed!\n");
 					goto done;
 				} else {
@@ -461,23 +707,62 @@ vm_dealloc_page (struct page *page) {
 /* Claim the page that allocate on VA. */
 bool
 vm_claim_page (void *va) {
-	struct page *page = spt_find_page(&thread_current()->spt, va);
+	// kswapd가 eviction policy의 자료구조를 건드릴 수 있으므로 lock
+	// swap in 동안에는 vm_do_claim_page()가 잠시 놓음
+	// ksmd가 페이지를 병합하며 해제할 수 있으므로 lock을 잡고 찾음
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	if (!spt_find_page(spt, va) && !mmap_alloc_page(spt, va))
+		heap_alloc_page(spt, va); // 아직 만들어지지 않은 mmap, heap 페이지 (read-ahead 등)
+
+	lock_acquire(&frame_list_lock);
+	struct page *page = spt_find_page(spt, va);
 
 	if (!page)
 		PANIC("[DBG] vm_claim_page(): spt_find_page() failed\n");
 
-	return vm_do_claim_page (page);
+	bool succ = vm_do_claim_page (page);
+	lock_release(&frame_list_lock);
+	return succ;
 }
 
 /* Claim the PAGE and set up the mmu. */
+// frame_list_lock을 잡은 상태로 호출, swap in 동안 lock을 놓았다가 다시 잡고 반환
+// 성공했다면 lock을 잡고 있는 동안 page는 물리 메모리 상에 있음
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+
+	// lock을 기다리는 동안 공유중인 다른 쓰레드가 이미 claim했을 수 있음
+	vm_page_wait_io(page);
+	if (page->frame)
+		return true;
+
+	// 같은 페이지에 fault한 다른 쓰레드는 swap in이 끝날 때까지 기다림
+	page->io_state = PAGE_IO_IN;
+	lock_release(&frame_list_lock);
+	struct frame *frame = vm_get_frame (page_needs_zero(page));
 
 	/* Set links */
 	frame->page = page;
 	page->frame = frame;
 
+	// 내용을 kva로 먼저 채우고 나서 pml4에 삽입
+	// 다른 공유 쓰레드가 채워지기 전의 프레임을 보지 않도록
+	bool succ = swap_in (page, frame->kva);
+	lock_acquire(&frame_list_lock);
+	if (!succ) {
+		page->frame = NULL;
+		frame->page = NULL;
+		vm_free_frame(frame);
+		vm_page_io_done(page);
+		return false;
+	}
+	// kva로 쓰면서 켜진 kernel pte의 dirty bit 복구
+	pml4_pte_set_dirty(base_pml4, frame->kpte, frame->kva, false);
+
+	// 페이지가 채워진 프레임을 eviction policy에 등록
+	evict_policy->insert(frame);
+
 	// pml4에 삽입
 	bool writable = page->writable && page->share_cnt == 1;
 	struct list *share_list = &page->share_list;
@@ -488,10 +773,11 @@ vm_do_claim_page (struct page *page) {
 		 e != list_end(share_list); e = list_next(e)) {
 		// 페이지에 subscribe중인 모든 spt에 대해 pml4에 삽입
 		se = list_entry(e, struct spt_elem, elem);
-		pml4_set_page(se->spt->pml4, page->va, frame->kva, writable);
+		map_page(se, page, writable);
 	}
 
-	return swap_in (page, frame->kva);
+	vm_page_io_done(page);
+	return true;
 }
 
 /* Initialize new supplemental page table */
@@ -503,6 +789,11 @@ supplemental_page_table_init (struct supplemental_page_table *spt) {
 
 	hash_init(&spt->hash, page_va_hash_func, page_va_less_func, spt);
 	hash_init(&spt->mmap_hash, mmap_addr_hash_func, mmap_addr_less_func, spt);
+	list_init(&spt->mmap_list);
+	spt->mmap_hint = NULL;
+	lock_init(&spt->mmap_lock);
+	spt->heap_start = spt->brk = NULL; // process.c load()에서 설정
+	spt->tlb = NULL;
 }
 
 /* Copy supplemental page table from src to dst */
@@ -510,6 +801,14 @@ bool
 supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src) {
 	struct hash_iterator i;
+	bool succ = false;
+
+	// 부모의 페이지가 복사 도중 evict되지 않도록 lock
+	lock_acquire(&frame_list_lock);
+	// 삽입하는 mmap 페이지를 자식의 mmap_elem에 연결하도록 먼저 복사
+	lock_acquire(&dst->mmap_lock);
+	copy_mmap_hash(src, dst);
+	lock_release(&dst->mmap_lock);
 
 	hash_first (&i, &src->hash);
 	struct page_elem *pe;
@@ -517,28 +816,43 @@ supplemental_page_table_copy (struct supplemental_page_table *dst,
 	while (hash_next (&i)) {
 		pe = hash_entry (hash_cur (&i), struct page_elem, elem);
 		page = pe->page;
+		// kswapd가 swap out 중이라면 끝난 뒤의 상태로 복사
+		// 대기 중에도 부모는 fork에서 멈춰있으므로 src hash는 변하지 않음
+		vm_page_wait_io(page);
 
 		// 자신의 spt에 삽입
 		if (!spt_insert_page(dst, page)) {
 			printf("[DBG] supplemental_page_table_copy(): spt_insert_page failed\n");
-			return false;
+			goto done;
+		}
+		if (pe->mmap) {
+			// 자식의 같은 주소의 mmap_elem에 연결
+			struct mmap_elem temp_me;
+			temp_me.addr = pe->mmap->addr;
+			struct hash_elem *e = hash_find(&dst->mmap_hash, &temp_me.elem);
+			spt_link_mmap_page(dst, page->va,
+							   hash_entry(e, struct mmap_elem, elem));
 		}
 		if (page->frame) {
 			// 물리 메모리 상에 있다면 pml4에도 삽입 (write-protect 상태로)
-			pml4_set_page(dst->pml4, page->va, page->frame->kva, false);
+			struct spt_elem *dst_se = find_spt_elem(dst, page);
+			struct spt_elem *src_se = find_spt_elem(src, page);
+			map_page(dst_se, page, false);
 
 			// dirty 상태 여부도 기존 페이지 주인에게 상속받기
-			bool is_dirty = pml4_is_dirty(src->pml4, page->va);
-			if (is_dirty) {
-				pml4_set_dirty(dst->pml4, page->va, is_dirty);
+			if (src_se->pte && (*src_se->pte & PTE_D) && dst_se->pte) {
+				pml4_pte_set_dirty(dst->pml4, dst_se->pte, page->va, true);
 			}
 		}
 	}
 
-	hash_init(&dst->mmap_hash, mmap_addr_hash_func, mmap_addr_less_func, dst);
-	copy_mmap_hash(&src->mmap_hash, &dst->mmap_hash);
+	dst->heap_start = src->heap_start;
+	dst->brk = src->brk;
+	succ = true;
 
-	return true;
+done:
+	lock_release(&frame_list_lock);
+	return succ;
 }
 
 /* Free the resource hold by the supplemental page table */
@@ -548,52 +862,305 @@ supplemental_page_table_kill (struct supplemental_page_table *spt) {
 	// supplemental_page_table_init()을 수행하지 않으면서 kill을 수행하므로,
 	// process_exec()로 생성된 쓰레드 (is_user가 true인 쓰레드)에 대해서만 수행
 	if (thread_current()->is_user) {
+		struct hash_iterator i;
+		struct tlb_gather tlb;
+
 		lock_acquire(&frame_list_lock);
-		hash_clear(&spt->mmap_hash, mmap_hash_destructor); // munmap 정리
+		// 모든 페이지를 제거한 뒤 TLB를 한 번만 비움
+		bool started = spt_tlb_gather_begin(spt, &tlb);
+		// mmap 페이지는 만들어진 페이지만 순회하며 write-back
+		// 제거는 아래의 hash_clear()에서 다른 페이지와 함께 한 번에 수행
+		hash_first(&i, &spt->mmap_hash);
+		while (hash_next(&i)) {
+			struct mmap_elem *me = hash_entry(hash_cur(&i),
+											  struct mmap_elem, elem);
+			struct list_elem *e;
+			for (e = list_begin(&me->pages); e != list_end(&me->pages);
+				 e = list_next(e)) {
+				mmap_write_back_page(me, list_entry(e, struct page_elem,
+													mmap_link));
+			}
+		}
 		hash_clear(&spt->hash, page_hash_destructor); // spt 정리
+		spt_tlb_gather_end(spt, started);
 		lock_release(&frame_list_lock);
+		text_close_dead(); // 마지막으로 떠난 text 페이지의 inode
+
+		// 더 이상 이 spt를 구독하는 페이지가 없으므로 파일을 닫아도 됨
+		lock_acquire(&spt->mmap_lock);
+		hash_clear(&spt->mmap_hash, mmap_hash_destructor); // munmap 정리
+		list_init(&spt->mmap_list);
+		spt->mmap_hint = NULL;
+		lock_release(&spt->mmap_lock);
+	}
+}
+
+// lazy load 정보를 담을 uninit_page_args를 할당
+// 사용이 끝나면 free()로 해제 (anon_initializer(), lazy load 함수 등)
+struct uninit_page_args *vm_alloc_page_args(void) {
+	return slab_alloc(&upargs_cache);
+}
+
+// 처음 접근할 때 0으로 채워지는 anon 페이지를 할당 (anonymous mmap, sbrk)
+bool vm_alloc_anon_zero_page(void *upage, bool writable) {
+	struct uninit_page_args *upargs = vm_alloc_page_args();
+	if (!upargs)
+		return false;
+	upargs->is_stack = false; // initializer가 없으므로 anon_initializer에서 free
+
+	if (!vm_alloc_page_with_initializer(VM_ANON, upage, writable, NULL, upargs)) {
+		free(upargs);
+		return false;
+	}
+	return true;
+}
+
+// 같은 실행 파일의 같은 위치를 다른 프로세스가 이미 불러왔다면 그 페이지를 spt에 공유
+// 공유할 페이지가 없으면 false를 반환하고, 호출자가 새 페이지를 만듦
+bool vm_share_text_page(struct supplemental_page_table *spt, struct file *file,
+						off_t ofs, void *va, uint32_t read_bytes) {
+	struct text_page key;
+	key.inode = file_get_inode(file);
+	key.ofs = ofs;
+	key.va = va;
+	key.read_bytes = read_bytes;
+
+	lock_acquire(&frame_list_lock);
+	struct hash_elem *e = hash_find(&text_table, &key.elem);
+	if (!e) {
+		lock_release(&frame_list_lock);
+		return false;
+	}
+	struct page *page = hash_entry(e, struct text_page, elem)->page;
+
+	vm_page_wait_io(page);
+	if (!spt_insert_page(spt, page)) {
+		PANIC("[DBG] vm_share_text_page(): spt_insert_page failed\n");
+	}
+	if (page->frame) {
+		// 이미 물리 메모리 상에 있다면 fault 없이 바로 사용하도록 매핑
+		map_page(find_spt_elem(spt, page), page, false);
+	}
+	lock_release(&frame_list_lock);
+	return true;
+}
+
+// 파일에서 불러온 read-only 페이지를 text table에 등록하여 다른 프로세스와 공유
+// lazy_load_segment()에서 호출 (swap in 중이므로 frame_list_lock은 잡혀있지 않음)
+void vm_register_text_page(struct page *page, struct file *file,
+						   off_t ofs, uint32_t read_bytes) {
+	ASSERT(!page->writable);
+
+	text_close_dead();
+
+	struct text_page *tp = malloc(sizeof(*tp));
+	if (!tp)
+		return; // 공유하지 못할 뿐 문제 없음
+	// inode는 frame_list_lock 밖에서 열고 닫음
+	tp->inode = inode_reopen(file_get_inode(file));
+	tp->ofs = ofs;
+	tp->va = page->va;
+	tp->read_bytes = read_bytes;
+	tp->page = page;
+
+	lock_acquire(&frame_list_lock);
+	bool dup = hash_insert(&text_table, &tp->elem) != NULL;
+	if (!dup)
+		page->text = tp;
+	lock_release(&frame_list_lock);
+
+	if (dup) {
+		// 동시에 실행된 다른 프로세스가 먼저 등록함
+		inode_close(tp->inode);
+		free(tp);
 	}
 }
 
 // syscall.c 전용 함수
 // 주어진 주소의 페이지가 writable인지 반환
 bool vm_get_addr_writable(void *va) {
-	struct page *page = spt_find_page(&thread_current()->spt, va);
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct page *page = spt_find_page(spt, va);
 
 	// WIP: page가 없어도 writable이라고 판단해야함?
 
-	// page가 없어도 잠재적 stack growth 가능성이 있으므로 true 반환
-	return page && page->writable;
+	if (!page) {
+		// 아직 접근하지 않은 mmap, heap 영역은 접근 시 fault에서 페이지가 만들어짐
+		struct mmap_elem *me = find_mmap_elem(spt, va);
+		return me ? me->writable : heap_range_overlaps(spt, va, 1);
+	}
+	return page->writable;
 }
 
-// 주어진 주소의 페이지가 spt에 있는지 여부 반환
+// 주어진 주소의 페이지가 spt에 있는지 (또는 mmap, heap 영역인지) 여부 반환
 bool vm_get_addr_readable(void *va) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	return spt_find_page(spt, va) || find_mmap_elem(spt, va)
+		   || heap_range_overlaps(spt, va, 1);
+}
+
+// 물리 메모리 상의 페이지가 dirty인지 반환
+// 현재 쓰레드와 무관하게 공유중인 모든 pml4와 kernel pml4를 확인
+bool vm_page_is_dirty(struct page *page) {
+	ASSERT(page->frame != NULL);
+
+	if ((*page->frame->kpte) & PTE_D)
+		return true;
+
+	struct list *share_list = &page->share_list;
+	struct list_elem *e;
+	struct spt_elem *se;
+	for (e = list_begin(share_list);
+		 e != list_end(share_list); e = list_next(e)) {
+		se = list_entry(e, struct spt_elem, elem);
+		if (se->pte && (*se->pte & PTE_D))
+			return true;
+	}
+	return false;
+}
+
+// page의 swap in/out이 끝날 때까지 대기, frame_list_lock을 잡은 상태로 호출
+// 반환 후 lock을 놓기 전까지 page->frame을 믿을 수 있음
+void vm_page_wait_io(struct page *page) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+
+	// 기다리는 동안 ksmd가 page를 병합하며 해제하지 않도록 표시
+	page->io_waiters++;
+	while (page->io_state != PAGE_IO_NONE)
+		cond_wait(&page_io_cond, &frame_list_lock);
+	page->io_waiters--;
+}
+
+// page의 I/O가 끝났음을 표시하고 기다리는 쓰레드를 깨움, frame_list_lock을 잡은 상태로 호출
+void vm_page_io_done(struct page *page) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+
+	page->io_state = PAGE_IO_NONE;
+	cond_broadcast(&page_io_cond, &frame_list_lock);
+}
+
+// 물리 메모리 상의 페이지의 dirty bit을 모두 지움 (msync로 write-back한 뒤)
+void vm_page_clear_dirty(struct page *page) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+	ASSERT(page->frame != NULL);
+
+	struct frame *frame = page->frame;
+	struct list *share_list = &page->share_list;
+	struct list_elem *e;
+	struct spt_elem *se;
+
+	pml4_pte_set_dirty(base_pml4, frame->kpte, frame->kva, false);
+	for (e = list_begin(share_list);
+		 e != list_end(share_list); e = list_next(e)) {
+		se = list_entry(e, struct spt_elem, elem);
+		if (se->pte)
+			pml4_pte_set_dirty(se->spt->pml4, se->pte, page->va, false);
+	}
+}
+
+// va의 페이지가 물리 메모리 상에 있다면 정책과 무관하게 바로 evict하고 프레임을 반환
+// madvise(MADV_DONTNEED), sequential mmap의 drop-behind에서 사용
+void vm_evict_page(void *va) {
+	lock_acquire(&frame_list_lock);
 	struct page *page = spt_find_page(&thread_current()->spt, va);
-	return page;
+	if (!page) {
+		// 아직 접근하지 않은 mmap 페이지: 물리 메모리에 없음
+		lock_release(&frame_list_lock);
+		return;
+	}
+	vm_page_wait_io(page);
+	if (page->frame) {
+		struct frame *frame = page->frame;
+		evict_policy->remove(frame);
+		vm_page_out(frame);
+		vm_free_frame(frame);
+	}
+	lock_release(&frame_list_lock);
 }
 
 ////////////////////////////////// STATICS /////////////////////////////////////
 
+
+// claim할 페이지가 0으로 채워진 프레임을 필요로 하는지 여부
+// initializer가 없는 uninit anon 페이지 (stack, bss, anonymous mmap, sbrk)만 0이 필요하고,
+// lazy load, swap in은 페이지 전체를 덮어씀
+static bool page_needs_zero(struct page *page) {
+	return VM_TYPE(page->operations->type) == VM_UNINIT &&
+		   page->uninit.init == NULL;
+}
+
 // hash table에 삽입할 page_elem 만들어서 반환
 static struct page_elem *new_page_elem(struct page *page) {
-	struct page_elem *pe = malloc(sizeof(*pe));
+	struct page_elem *pe = slab_alloc(&page_elem_cache);
 	if (!pe)
-		PANIC("[DBG] new_page_elem(): malloc for page_elem failed!\n");
+		PANIC("[DBG] new_page_elem(): slab_alloc for page_elem failed!\n");
 
 	pe->page = page;
+	pe->mmap = NULL; // mmap 페이지라면 spt_link_mmap_page()에서 설정
 	return pe;
 }
 
+// spt에서 va의 page_elem을 찾아 반환, 없으면 NULL
+static struct page_elem *find_page_elem(struct supplemental_page_table *spt,
+										void *va) {
+	struct page temp_page;
+	struct page_elem temp_pe;
+	temp_page.va = pg_round_down(va);
+	temp_pe.page = &temp_page;
+
+	struct hash_elem *e = hash_find(&spt->hash, &temp_pe.elem);
+	return e ? hash_entry(e, struct page_elem, elem) : NULL;
+}
+
 // share_list에 삽입할 spt_elem 만들어서 반환
 static struct spt_elem *new_spt_elem(struct supplemental_page_table *spt) {
-	struct spt_elem *se = malloc(sizeof(*se));
+	struct spt_elem *se = slab_alloc(&spt_elem_cache);
 	if (!se)
-		PANIC("[DBG] new_spt_elem(): malloc for spt_elem failed!\n");
+		PANIC("[DBG] new_spt_elem(): slab_alloc for spt_elem failed!\n");
 
 	se->spt = spt;
+	se->pte = NULL; // map_page()에서 캐시
 	return se;
 }
 
+// page의 share_list에서 spt의 spt_elem을 찾아 반환
+static struct spt_elem *find_spt_elem(struct supplemental_page_table *spt,
+														struct page *page) {
+	struct list *share_list = &page->share_list;
+	struct list_elem *e;
+	struct spt_elem *se;
+
+	for (e = list_begin(share_list);
+		 e != list_end(share_list); e = list_next(e)) {
+		se = list_entry(e, struct spt_elem, elem);
+		if (se->spt == spt)
+			return se;
+	}
+	return NULL;
+}
+
+// se의 pml4에 page를 매핑하고 pte를 캐시
+static bool map_page(struct spt_elem *se, struct page *page, bool writable) {
+	ASSERT(se != NULL && page->frame != NULL);
+
+	if (!pml4_set_page(se->spt->pml4, page->va, page->frame->kva, writable))
+		return false;
+	if (!se->pte)
+		se->pte = pml4e_walk(se->spt->pml4, (uint64_t) page->va, 0);
+	return true;
+}
+
+// 아직 쓴 적 없는 PAGE 대신 공유 zero 페이지를 se의 pml4에 read-only로 매핑
+// 첫 쓰기에서 write fault가 나면 vm_do_claim_page()가 실제 프레임으로 교체
+static bool map_zero_page(struct spt_elem *se, struct page *page) {
+	ASSERT(se != NULL && page->frame == NULL);
+
+	if (!pml4_set_page(se->spt->pml4, page->va, zero_page, false))
+		return false;
+	if (!se->pte)
+		se->pte = pml4e_walk(se->spt->pml4, (uint64_t) page->va, 0);
+	return true;
+}
 
 // 현재 쓰레드를 주어진 page의 share에 참여시킴
 static void subscribe_page(struct supplemental_page_table *spt,
@@ -619,20 +1186,26 @@ static void subscribe_page(struct supplemental_page_table *spt,
 static void unsubscribe_page(struct supplemental_page_table *spt,
 													struct page *page) {
 	ASSERT(page != NULL);
-	struct list *share_list = &page->share_list;
-	struct list_elem *e;
-	struct spt_elem *se;
+	// swap 중인 페이지를 삭제하지 않도록
+	vm_page_wait_io(page);
 
 	// share_list에서 자신의 spt_elem을 탐색
-	for (e = list_begin(share_list);
-		 e != list_end(share_list); e = list_next(e)) {
-		se = list_entry(e, struct spt_elem, elem);
-		if (se->spt == spt) {
-			break;
-		}
+	struct spt_elem *se = find_spt_elem(spt, page);
+	ASSERT(se != NULL);
+
+	if (se->pte) {
+		// pml4에서 제거, dirty bit은 남은 공유자를 위해 kernel pte로 옮김
+		// 프레임이 없어도 zero 페이지가 매핑되어 있을 수 있으므로 항상 제거
+		if (page->frame && (*se->pte & PTE_D))
+			pml4_pte_set_dirty(base_pml4, page->frame->kpte,
+							   page->frame->kva, true);
+		if (spt->tlb) // 여러 페이지를 제거하는 중: TLB 무효화는 나중에 한 번에
+			tlb_gather_clear_page(spt->tlb, se->pte, page->va);
+		else
+			pml4_pte_clear_page(spt->pml4, se->pte, page->va);
 	}
 	list_remove(&se->elem); // share_list로부터 삭제
-	free(se);
+	slab_free(se);
 	page->share_cnt--;
 
 
@@ -649,132 +1222,347 @@ static void unsubscribe_page(struct supplemental_page_table *spt,
 		// 더 이상 share중인 페이지가 없다면 페이지를 삭제
 		if (page->frame) {
 			// 물리 메모리 상에 있다면 프레임을 반환
-			list_remove(&page->frame->elem);
-			free(page->frame);
+			struct frame *frame = page->frame;
+			evict_policy->remove(frame);
+			frame->page = NULL;
+			vm_free_frame(frame);
+		} else if (evict_policy->forget) {
+			// 정책이 기억하고 있는 ghost 정보 제거
+			evict_policy->forget(page);
+		}
+		if (page->text) {
+			// 마지막 프로세스가 떠남: text table에서 제거
+			// inode는 lock을 놓은 뒤 text_close_dead()에서 닫음
+			hash_delete(&text_table, &page->text->elem);
+			list_push_back(&text_dead, &page->text->dead_elem);
 		}
 		vm_dealloc_page (page);
 	}
 }
 
-// ======================= [Evict policy helpers] ==============================
-static void insert_into_frame_list(struct frame *frame) {
-	if (evict_policy == EP_CLCK) {
-		// clock algorithm은 기존 list 구조체 대신 순환 리스트로 구현
-		// sentinel 직전에 삽입
-		list_insert(&frame_nil.elem, &frame->elem);
-	} else {
-		list_push_back(&frame_list, &frame->elem);
+// text table에서 제거된 항목의 inode를 닫음, frame_list_lock 없이 호출
+static void text_close_dead(void) {
+	ASSERT(!lock_held_by_current_thread(&frame_list_lock));
+
+	for (;;) {
+		lock_acquire(&frame_list_lock);
+		struct text_page *tp = list_empty(&text_dead) ? NULL :
+			list_entry(list_pop_front(&text_dead), struct text_page, dead_elem);
+		lock_release(&frame_list_lock);
+		if (!tp)
+			break;
+		inode_close(tp->inode);
+		free(tp);
 	}
 }
 
-// Lenient LRU에서 사용
-// frame_list에서 accessed 비트가 표시된 페이지들을 뒤로 밀고 accessed를 제거
-static void push_accessed_frame_back(void) {
-	struct list_elem *nil_elem = &frame_nil.elem; // sentinel
-
-	list_remove(nil_elem);
-	list_push_back(&frame_list, nil_elem); // sentinel을 맨 뒤로 보내기
-
-	struct frame *frame;
-	void *va;
-	bool accessed;
+// ========================= [Zero pool helpers] ===============================
+// zero pool에서 0으로 채워진 프레임의 kva를 꺼내 반환, 비어있으면 NULL
+static void *zero_pool_get(void) {
+	void *kva = NULL;
 
-	struct list *share_list;
-	struct list_elem *e, *e2;
-	struct spt_elem *se;
+	lock_acquire(&zero_pool_lock);
+	if (!list_empty(&zero_pool)) {
+		kva = list_pop_front(&zero_pool);
+		zero_pool_cnt--;
+	}
+	if (zero_pool_cnt < ZERO_POOL_LOW && zerod_idle) {
+		// 풀이 부족해지면 zerod를 깨움
+		zerod_idle = false;
+		sema_up(&zerod_sema);
+	}
+	lock_release(&zero_pool_lock);
 
-	for (e = list_begin(&frame_list); e != nil_elem; e = list_next(e)) {
-		frame = list_entry(e, struct frame, elem);
+	if (kva) {
+		// 리스트 연결에 사용한 앞부분만 다시 0으로
+		memset(kva, 0, sizeof(struct list_elem));
+	}
+	return kva;
+}
 
-		va = frame->page->va;
-		accessed = false;
-		// '구독'중인 모든 spt의 pml4의 accessed bit 확인
-		share_list = &frame->page->share_list;
-		for (e2 = list_begin(share_list);
-			 e2 != list_end(share_list); e2 = list_next(e2)) {
-			se = list_entry(e2, struct spt_elem, elem);
+// PRI_MIN으로 실행되어 다른 쓰레드가 없을 때만 프레임을 미리 0으로 채움
+static void zerod(void *aux UNUSED) {
+	thread_set_nice(NICE_MAX); // mlfqs에서도 가장 낮은 priority 유지
 
-			if (pml4_is_accessed(se->spt->pml4, va)) {
-				accessed = true;
-				pml4_set_accessed(se->spt->pml4, va, false); // 복구
+	for (;;) {
+		while (zero_pool_cnt < ZERO_POOL_HIGH) {
+			void *kva = palloc_get_page(PAL_USER);
+			if (!kva) {
+				// user pool이 가득 참: 이미 채워둔 프레임으로 만족
 				break;
 			}
-		}
+			memset(kva, 0, PGSIZE);
 
-		// 커널 pml4의 accessed bit 확인
-		if (!accessed && (*frame->kpte) & PTE_A) {
-			// user page 모두 accessed 아닐 때만 확인
-			accessed = true;
-			pml4_set_accessed(base_pml4, frame->kva, false); // 복구
+			lock_acquire(&zero_pool_lock);
+			list_push_back(&zero_pool, (struct list_elem *) kva);
+			zero_pool_cnt++;
+			lock_release(&zero_pool_lock);
 		}
 
-		// accessed인 프레임은 맨 뒤로 보냄
-		if (accessed) {
-			e = list_prev(e);
-			list_remove(&frame->elem);
-			list_push_back(&frame_list, &frame->elem);
-		}
+		lock_acquire(&zero_pool_lock);
+		zerod_idle = true;
+		lock_release(&zero_pool_lock);
+		sema_down(&zerod_sema);
 	}
-
-	list_remove(nil_elem);
-	list_push_front(&frame_list, nil_elem); // sentinel 다시 맨 앞으로
 }
 
-// clock algorithm에서 사용
-// accessed bit이 0인 첫 번째 프레임을 탐색, 1인 프레임은 0으로 만들고 스킵
-static struct frame *second_wind(void) {
-	struct list *share_list;
-	struct list_elem *e, *e2;
+// ======================= [Page-out daemon helpers] ===========================
+// 바로 사용 가능한 user 프레임 수 (user pool의 빈 페이지 + zero pool)
+static size_t free_frame_cnt(void) {
+	return palloc_free_cnt(PAL_USER) + zero_pool_cnt;
+}
 
-	struct frame *frame;
-	void *va;
-	bool accessed;
+static void kswapd_wakeup(void) {
+	enum intr_level old_level = intr_disable();
+	if (kswapd_idle) {
+		kswapd_idle = false;
+		sema_up(&kswapd_sema);
+	}
+	intr_set_level(old_level);
+}
 
+// 페이지를 '구독'중인 모든 pml4에서 제거
+// user pte의 dirty bit은 사라지므로 kernel pte로 옮겨둠 (write-back 판단용)
+static void unmap_page_from_sharers(struct page *page) {
+	struct frame *frame = page->frame;
+	struct list *share_list = &page->share_list;
+	struct list_elem *e;
 	struct spt_elem *se;
-	struct lock *share_list_lock;
 
-	struct list_elem *nil_elem = &frame_nil.elem; // sentinel
+	for (e = list_begin(share_list);
+		 e != list_end(share_list); e = list_next(e)) {
+		se = list_entry(e, struct spt_elem, elem);
 
-	e = list_next(nil_elem);
-	list_remove(nil_elem); // sentinel 뽑아놓기
-	
-	while (e) {
-		frame = list_entry(e, struct frame, elem);
+		if (!se->pte)
+			continue;
+
+		// dirty 확인과 삭제 사이에 쓰기가 끼어들지 않도록
+		enum intr_level old_level = intr_disable();
+		if (*se->pte & PTE_D)
+			pml4_pte_set_dirty(base_pml4, frame->kpte, frame->kva, true);
+		pml4_pte_clear_page(se->spt->pml4, se->pte, page->va);
+		intr_set_level(old_level);
+	}
+}
 
-		va = frame->page->va;
-		accessed = false;
+// 빈 프레임이 low watermark 아래로 떨어지면 깨어나서
+// high watermark까지 미리 evict하여 fault 경로에서의 동기 eviction을 줄임
+static void kswapd(void *aux UNUSED) {
+	for (;;) {
+		while (free_frame_cnt() < kswapd_high) {
+			// fault 처리 중인 쓰레드가 오래 기다리지 않도록 batch 단위로 lock
+			lock_acquire(&frame_list_lock);
+			// 물리 순서대로 accessed bit을 모아두어 victim 탐색을 가볍게
+			vm_age_frames();
+			for (int i = 0; i < KSWAPD_BATCH; i++) {
+				if (free_frame_cnt() >= kswapd_high || evict_policy->empty())
+					break;
 
-		// '구독'중인 모든 spt의 pml4의 accessed bit 확인
-		share_list = &frame->page->share_list;
-		for (e2 = list_begin(share_list);
-			 e2 != list_end(share_list); e2 = list_next(e2)) {
-			se = list_entry(e2, struct spt_elem, elem);
+				vm_free_frame(vm_evict_frame());
+			}
+			bool empty = evict_policy->empty();
+			lock_release(&frame_list_lock);
 
-			if (pml4_is_accessed(se->spt->pml4, va)) {
-				accessed = true;
-				pml4_set_accessed(se->spt->pml4, va, false); // 복구
+			if (empty) {
+				// 더 evict할 프레임이 없음
 				break;
 			}
 		}
 
-		// 커널 pml4의 accessed bit 확인
-		if (!accessed && (*frame->kpte) & PTE_A) {
-			// user page 모두 accessed 아닐 때만 확인
-			accessed = true;
-			pml4_set_accessed(base_pml4, frame->kva, false); // 복구
-		}
+		enum intr_level old_level = intr_disable();
+		kswapd_idle = true;
+		sema_down(&kswapd_sema);
+		intr_set_level(old_level);
+	}
+}
 
-		// accessed 0인 경우 evict할 페이지로 선택
-		if (!accessed) {
-			break;
-		} else {
-			e = list_next(e);
+// ========================= [Frame table helpers] =============================
+// 빈 kva에 대한 frame 구조체를 만들어 frame table에 등록
+static struct frame *new_frame(void *kva) {
+	// 나머지 필드는 frame_ctor()로 초기화된 상태
+	struct frame *frame = slab_alloc(&frame_cache);
+	if (!frame) {
+		PANIC("[DBG] new_frame(): slab_alloc for frame failed\n");
+	}
+	// frame의 kva, kernel pml4의 pte는 절대 변하지 않음
+	frame->kva = kva;
+	frame->kpte = pml4e_walk(base_pml4, kva, 0);
+	frame_table_set(kva, frame);
+	return frame;
+}
+
+// 페이지와 연결되지 않은 프레임을 user pool에 반환
+// 빈 프레임을 기다리는 vm_get_frame()을 깨움
+static void vm_free_frame(struct frame *frame) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+	ASSERT(frame->page == NULL);
+
+	frame_table_set(frame->kva, NULL);
+	palloc_free_page(frame->kva);
+	// frame_ctor()가 만든 상태로 되돌려서 반환
+	frame->evict_state = 0;
+	frame->fresh = false;
+	frame->referenced = false;
+	frame->ksm_sum = 0;
+	slab_free(frame);
+	cond_broadcast(&page_io_cond, &frame_list_lock);
+}
+
+// frame_cache의 constructor: 페이지와 연결되지 않은 초기 상태
+static void frame_ctor(void *frame_) {
+	struct frame *frame = frame_;
+	frame->page = NULL;
+	frame->evict_state = 0;
+	frame->fresh = false;
+	frame->referenced = false;
+	frame->ksm_sum = 0;
+}
+
+static void frame_table_set(void *kva, struct frame *frame) {
+	size_t idx = ((uint8_t *) kva - frame_table_base) / PGSIZE;
+	ASSERT(idx < frame_table_cnt);
+	frame_table[idx] = frame;
+}
+
+// 프레임을 물리 순서대로 AGE_BATCH개씩 훑으며 하드웨어 accessed bit을
+// frame->referenced로 모아둠. 이후 clock의 탐색은 대부분 이 bit만 보고 끝남
+// clock hand처럼 이어서 진행하므로 batch마다의 비용은 전체 프레임 수와 무관
+static void vm_age_frames(void) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+
+	for (size_t i = 0; i < AGE_BATCH && i < frame_table_cnt; i++) {
+		struct frame *frame = frame_table[age_cursor];
+		if (frame && frame->page && frame->page->io_state == PAGE_IO_NONE
+			&& frame_collect_accessed(frame))
+			frame->referenced = true;
+		if (++age_cursor == frame_table_cnt)
+			age_cursor = 0;
+	}
+}
+
+// ===================== [Same-page merging helpers] ===========================
+// 주기적으로 깨어나 frame table을 물리 순서대로 anon 프레임 KSM_BATCH개씩 확인
+static void ksmd(void *aux UNUSED) {
+	for (;;) {
+		timer_sleep(KSM_SCAN_TICKS);
+
+		lock_acquire(&frame_list_lock);
+		// 빈 프레임은 건너뛰고 hash를 계산한 프레임만 셈
+		size_t scanned = 0;
+		for (size_t i = 0; i < frame_table_cnt && scanned < KSM_BATCH; i++) {
+			if (ksm_scan_frame(ksm_cursor))
+				scanned++;
+			if (++ksm_cursor == frame_table_cnt) {
+				// 한 바퀴 끝: 후보를 버리고 다음 scan에서 새로 모음
+				ksm_cursor = 0;
+				hash_clear(&ksm_table, ksm_node_destructor);
+			}
 		}
+		lock_release(&frame_list_lock);
 	}
+}
 
-	list_insert(e, nil_elem); // sentinel을 탐색 지점으로 이동
+// 병합 대상: I/O 중이 아니고 쓰기 가능한 anon 페이지
+// (read-only anon 페이지는 text table로 이미 공유됨)
+static bool ksm_mergeable(struct page *page) {
+	return page && page->io_state == PAGE_IO_NONE && page->io_waiters == 0
+		   && page->writable
+		   && VM_TYPE(page->operations->type) == VM_ANON;
+}
 
-	return frame;
+// frame_table[IDX]의 내용을 hash하여 같은 va, 같은 hash의 후보가 있으면 병합
+// 병합 대상이 아니라 hash하지 않았다면 false 반환
+static bool ksm_scan_frame(size_t idx) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+
+	struct frame *frame = frame_table[idx];
+	if (!frame || !ksm_mergeable(frame->page))
+		return false;
+
+	uint64_t sum = hash_bytes(frame->kva, PGSIZE);
+	if (sum != frame->ksm_sum) {
+		// 직전 scan 이후 내용이 바뀜: 곧 다시 쓰일 페이지일 가능성이 높으므로 보류
+		frame->ksm_sum = sum;
+		return true;
+	}
+
+	struct ksm_node key;
+	key.va = frame->page->va;
+	key.sum = sum;
+	struct hash_elem *e = hash_find(&ksm_table, &key.elem);
+	if (!e) {
+		struct ksm_node *node = malloc(sizeof(*node));
+		if (!node)
+			return true; // 이번 scan에서 병합하지 못할 뿐 문제 없음
+		node->idx = idx;
+		node->va = key.va;
+		node->sum = sum;
+		hash_insert(&ksm_table, &node->elem);
+		return true;
+	}
+
+	struct ksm_node *node = hash_entry(e, struct ksm_node, elem);
+	struct frame *stable = frame_table[node->idx];
+	if (stable && stable != frame && ksm_mergeable(stable->page)
+		&& stable->page->va == key.va && stable->ksm_sum == sum) {
+		ksm_merge(stable->page, frame->page);
+	} else {
+		// 이전 후보가 해제되었거나 바뀜: 이 프레임을 새 후보로
+		node->idx = idx;
+	}
+	return true;
+}
+
+// DUP의 내용이 STABLE과 같다면 DUP를 구독중인 모든 spt가 STABLE을 공유하도록
+// 옮기고 DUP와 그 프레임을 해제. 병합 여부를 반환
+static bool ksm_merge(struct page *stable, struct page *dup) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+	ASSERT(stable->va == dup->va && stable->frame && dup->frame);
+
+	void *va = stable->va;
+
+	// 비교부터 pte 교체까지 사용자 프로세스가 두 페이지에 쓰지 못하도록
+	enum intr_level old_level = intr_disable();
+	if (memcmp(stable->frame->kva, dup->frame->kva, PGSIZE)) {
+		intr_set_level(old_level);
+		return false;
+	}
+
+	if (stable->share_cnt == 1) {
+		// 처음 공유됨: 원래 주인의 pte를 write-protect (subscribe_page()와 같음)
+		struct spt_elem *src_se = list_entry(list_begin(&stable->share_list),
+											 struct spt_elem, elem);
+		pml4_set_writable(src_se->spt->pml4, va, false);
+	}
+
+	while (!list_empty(&dup->share_list)) {
+		struct spt_elem *se = list_entry(list_pop_front(&dup->share_list),
+										 struct spt_elem, elem);
+
+		// spt의 page_elem이 STABLE을 가리키도록 (va가 같으므로 hash 위치는 그대로)
+		struct page_elem temp_pe;
+		temp_pe.page = dup;
+		struct hash_elem *e = hash_find(&se->spt->hash, &temp_pe.elem);
+		ASSERT(e != NULL);
+		hash_entry(e, struct page_elem, elem)->page = stable;
+
+		// 물리 메모리 상의 페이지는 모든 구독자에게 매핑되어 있어야 함
+		map_page(se, stable, false);
+		list_push_back(&stable->share_list, &se->elem);
+		stable->share_cnt++;
+	}
+	dup->share_cnt = 0;
+	intr_set_level(old_level);
+
+	// 더 이상 아무도 보지 않는 DUP의 프레임 반환
+	struct frame *frame = dup->frame;
+	evict_policy->remove(frame);
+	frame->page = NULL;
+	dup->frame = NULL;
+	vm_free_frame(frame);
+	vm_dealloc_page(dup);
+	ksm_merged++;
+	return true;
 }
 
 // ========================= [SPT copy helpers] ================================
@@ -787,13 +1575,22 @@ static bool copy_page(struct page *old_page, struct page *new_page) {
 	new_page->writable = old_page->writable;
 	list_init(&new_page->share_list);
 	new_page->share_cnt = 0;
+	new_page->ghost = 0;
+	new_page->io_state = PAGE_IO_NONE;
+	new_page->io_waiters = 0;
+	new_page->text = NULL; // 쓰기가 가능한 복사본은 공유 대상이 아님
 	
 	switch(VM_TYPE(type)) {
 		case VM_UNINIT:
 			PANIC("[DBG] copy_page(): uninit page cannot write-fault\n");
 		case VM_ANON:
+			// old_page가 evict되어 있었다면 swap 공간은 old_page의 것
+			// 복사본은 바로 프레임을 받으므로 swap에 있지 않음
+			new_page->anon.in_swap = false;
 			break;
 		case VM_FILE:
+			// 섹터별 hash는 old_page의 것이므로 복사본은 페이지 전체를 write-back
+			new_page->file.sector_hash = NULL;
 			break;
 		case VM_PAGE_CACHE:
 			printf("[DBG] copy_page_cache_page() is not implemented yet\n");
@@ -805,30 +1602,87 @@ static bool copy_page(struct page *old_page, struct page *new_page) {
 	return true;
 }
 
-static void copy_mmap_hash(struct hash *old_h, struct hash *new_h) {
-	struct hash_iterator i;
-
-	struct hash_elem *e;
+// addr 순서를 유지하도록 src의 mmap_list를 순서대로 복사
+static void copy_mmap_hash(struct supplemental_page_table *src,
+						   struct supplemental_page_table *dst) {
+	struct list_elem *e;
 	struct mmap_elem *old_me;
 	struct mmap_elem *new_me;
 
-	hash_first (&i, old_h);
-	while (hash_next (&i))
-   	{
-		old_me = hash_entry (hash_cur (&i), struct mmap_elem, elem);
+	for (e = list_begin(&src->mmap_list); e != list_end(&src->mmap_list);
+		 e = list_next(e)) {
+		old_me = list_entry(e, struct mmap_elem, list_elem);
 		new_me = malloc(sizeof(*new_me));
 		if (!new_me) {
 			PANIC("copy_mmap_hash(): malloc for new_me failed!\n");
 		}
 
-		new_me->file = file_reopen(old_me->file);
+		new_me->file = old_me->file ? file_reopen(old_me->file) : NULL;
 		new_me->addr = old_me->addr;
 		new_me->pg_cnt = old_me->pg_cnt;
+		new_me->ofs = old_me->ofs;
+		new_me->read_bytes = old_me->read_bytes;
+		new_me->writable = old_me->writable;
+		new_me->advice = old_me->advice;
+		new_me->next_fault = old_me->next_fault;
+		list_init(&new_me->pages); // 페이지를 자식 spt에 삽입하며 연결됨
+
+		hash_insert(&dst->mmap_hash, &new_me->elem);
+		list_push_back(&dst->mmap_list, &new_me->list_elem);
+	}
+}
+
+// mmap 영역에서 만들어진 페이지를 필요하면 write-back하고 모두 제거
+// 영역의 크기가 아니라 실제로 접근한 페이지 수에 비례
+// frame_list_lock을 잡은 상태로 호출 (do_munmap)
+void mmap_remove_pages(struct supplemental_page_table *spt,
+					   struct mmap_elem *me) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
+
+	struct tlb_gather tlb;
+	bool started = spt_tlb_gather_begin(spt, &tlb);
+	while (!list_empty(&me->pages)) {
+		struct page_elem *pe = list_entry(list_front(&me->pages),
+										  struct page_elem, mmap_link);
+		mmap_write_back_page(me, pe);
+		spt_remove_page(spt, pe->page); // me->pages에서도 제거됨
+	}
+	spt_tlb_gather_end(spt, started);
+}
+
+// mmap 페이지가 물리 메모리 상에 있고 dirty라면 파일에 write-back
+static void mmap_write_back_page(struct mmap_elem *me, struct page_elem *pe) {
+	ASSERT(lock_held_by_current_thread(&frame_list_lock));
 
-		hash_insert(old_h, &new_me->elem);
+	// kswapd가 swap 중이라면 끝난 뒤에 확인
+	// 기다리는 동안 ksmd가 병합하지 않으므로 pe->page는 바뀌지 않음
+	struct page *page = pe->page;
+	vm_page_wait_io(page);
+	if (page->frame && me->file) { // anonymous mmap은 write-back 불필요
+		file_backed_write_back(page, me->file);
 	}
 }
 
+// spt에서 페이지를 제거하며 지운 pte의 TLB 무효화를 tlb에 모아두기 시작
+// 이미 모으는 중이라면 (kill 중의 munmap 등) false를 반환하고 바깥에서 비움
+bool spt_tlb_gather_begin(struct supplemental_page_table *spt,
+						  struct tlb_gather *tlb) {
+	if (spt->tlb)
+		return false;
+	tlb_gather_init(tlb, spt->pml4);
+	spt->tlb = tlb;
+	return true;
+}
+
+// spt_tlb_gather_begin()이 STARTED를 반환했다면 모아둔 TLB 무효화를 수행
+// 제거한 페이지의 user 주소에 다시 접근하기 전에 호출해야 함
+void spt_tlb_gather_end(struct supplemental_page_table *spt, bool started) {
+	if (!started)
+		return;
+	tlb_gather_flush(spt->tlb);
+	spt->tlb = NULL;
+}
+
 // ======================= [Hash table functions] ==============================
 static bool page_va_less_func (const struct hash_elem *a,
 		const struct hash_elem *b, void *aux UNUSED) {
@@ -849,12 +1703,11 @@ static void page_hash_destructor(struct hash_elem *e, void *aux) {
 	struct page_elem *pe = hash_entry(e, struct page_elem, elem);
 	struct page *page = pe->page;
 
-	if (page->frame) { // 프레임에 있다면 pml4에서 제거
-		pml4_clear_page(spt->pml4, page->va);
-	}
-	unsubscribe_page(spt, page);
+	unsubscribe_page(spt, page); // 프레임에 있다면 pml4에서도 제거
 
-	free(pe);
+	if (pe->mmap)
+		list_remove(&pe->mmap_link);
+	slab_free(pe);
 }
 
 static bool mmap_addr_less_func (const struct hash_elem *a,
@@ -871,22 +1724,48 @@ static uint64_t mmap_addr_hash_func(const struct hash_elem *e, void *aux UNUSED)
 	return hash_bytes(&me->addr, sizeof(void*));
 }
 
-static void mmap_hash_destructor(struct hash_elem *e, void *aux) {
-	struct supplemental_page_table *spt = (struct supplemental_page_table*) aux;
+// 페이지는 mmap_remove_pages()로 미리 제거되어 있어야 함
+static bool text_page_less_func (const struct hash_elem *a,
+		const struct hash_elem *b, void *aux UNUSED) {
+	struct text_page *tpa = hash_entry(a, struct text_page, elem);
+	struct text_page *tpb = hash_entry(b, struct text_page, elem);
+
+	if (tpa->inode != tpb->inode)
+		return tpa->inode < tpb->inode;
+	if (tpa->va != tpb->va)
+		return tpa->va < tpb->va;
+	if (tpa->ofs != tpb->ofs)
+		return tpa->ofs < tpb->ofs;
+	return tpa->read_bytes < tpb->read_bytes;
+}
 
-	struct mmap_elem *me = hash_entry(e, struct mmap_elem, elem);
-	void *addr = me->addr;
+static uint64_t text_page_hash_func(const struct hash_elem *e, void *aux UNUSED) {
+	struct text_page *tp = hash_entry(e, struct text_page, elem);
 
-	struct page *page;
-	// mmap으로 생성된 file_page를 모두 제거
-	for (int i = 0; i < me->pg_cnt; i++) {
-		page = spt_find_page(spt, addr + PGSIZE * i);
-		
-		if (page->frame) {
-			file_backed_write_back(page, me->file);
-		}
-		spt_remove_page(&thread_current()->spt, page);
-	}
+	return hash_bytes(&tp->inode, sizeof(void*)) ^ hash_bytes(&tp->va, sizeof(void*));
+}
+
+static bool ksm_node_less_func (const struct hash_elem *a,
+		const struct hash_elem *b, void *aux UNUSED) {
+	const struct ksm_node *na = hash_entry(a, struct ksm_node, elem);
+	const struct ksm_node *nb = hash_entry(b, struct ksm_node, elem);
+
+	if (na->va != nb->va)
+		return na->va < nb->va;
+	return na->sum < nb->sum;
+}
+
+static uint64_t ksm_node_hash_func(const struct hash_elem *e, void *aux UNUSED) {
+	const struct ksm_node *node = hash_entry(e, struct ksm_node, elem);
+	return hash_bytes(&node->va, sizeof(void*)) ^ node->sum;
+}
+
+static void ksm_node_destructor(struct hash_elem *e, void *aux UNUSED) {
+	free(hash_entry(e, struct ksm_node, elem));
+}
+
+static void mmap_hash_destructor(struct hash_elem *e, void *aux UNUSED) {
+	struct mmap_elem *me = hash_entry(e, struct mmap_elem, elem);
 
 	file_close(me->file);
 	free(me);